@@ -0,0 +1,600 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <new>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <memory>
+#include "config.h"
+#include "logger.h"
+#include "lidar_types.h"
+#include "pktdata.h"
+#include "frame_grid.h"
+#include "payload_decoder.h"
+#include "packet_parser.h"
+#include "point_cloud.h"
+#include "ring_buffer.h"
+#include "spsc_ring_buffer.h"
+#include "packet_pool.h"
+
+// 性能基准测试程序
+// 用法: rk3576_LDlidar_bench [--json 结果文件] [--filter 名称子串] [--label 标签] [--dir 输出目录 | 输出目录]
+// 在 x86 测试机和目标板上运行同一组热点路径微基准，每项重复多次取中位数，
+// 输出 ns/op、吞吐和每次操作的堆分配次数；--json 写出机器可读的结果，便于跨提交、跨平台对比。
+
+// 统计堆分配次数：基准程序替换全局 operator new / operator delete
+// 两者都不内联，调用处看不到内部的 malloc/free，编译器不会把 new 出的指针误判为交给了 free（-Wmismatched-new-delete）
+static std::atomic<uint64_t> g_allocations(0);
+
+__attribute__((noinline)) void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    constexpr int Repeats = 5;                         // 每项重复次数，取中位数
+    constexpr int PacketsPerFrame = 32 * 52;
+
+    // 一次测量的累计值
+    struct Sample {
+        uint64_t ops = 0;
+        double ns = 0.0;
+        uint64_t allocs = 0;
+    };
+
+    // 一项基准的结果
+    struct BenchResult {
+        std::string name;
+        std::string unit;          // 一次操作的含义
+        uint64_t ops;              // 单次重复的操作数
+        double nsPerOp;            // 各次重复的中位数
+        double nsPerOpMin;
+        double opsPerSec;
+        double mbPerSec;           // 不适用时为 0
+        double allocsPerOp;
+    };
+
+    std::vector<BenchResult> g_results;
+    std::string g_filter;
+
+    // 计时并统计区间内的堆分配
+    class Stopwatch {
+    public:
+        void start()
+        {
+            allocs_ = g_allocations.load(std::memory_order_relaxed);
+            start_ = Clock::now();
+        }
+
+        void stop(Sample &sample, uint64_t ops)
+        {
+            sample.ns += std::chrono::duration<double, std::nano>(Clock::now() - start_).count();
+            sample.allocs += g_allocations.load(std::memory_order_relaxed) - allocs_;
+            sample.ops += ops;
+        }
+
+    private:
+        Clock::time_point start_;
+        uint64_t allocs_ = 0;
+    };
+
+    bool selected(const char *name)
+    {
+        return g_filter.empty() || strstr(name, g_filter.c_str()) != nullptr;
+    }
+
+    // 汇总各次重复：ns/op 取中位数，bytesPerOp 大于 0 时给出 MB/s
+    void addResult(const std::string &name, const std::string &unit, const std::vector<Sample> &samples,
+                   double bytesPerOp)
+    {
+        std::vector<double> nsPerOp;
+        uint64_t ops = 0;
+        uint64_t allocs = 0;
+        for (const auto &s : samples)
+        {
+            nsPerOp.push_back(s.ops > 0 ? s.ns / s.ops : 0.0);
+            ops += s.ops;
+            allocs += s.allocs;
+        }
+        std::sort(nsPerOp.begin(), nsPerOp.end());
+
+        BenchResult r;
+        r.name = name;
+        r.unit = unit;
+        r.ops = samples.empty() ? 0 : samples[0].ops;
+        r.nsPerOp = nsPerOp[nsPerOp.size() / 2];
+        r.nsPerOpMin = nsPerOp[0];
+        r.opsPerSec = r.nsPerOp > 0 ? 1e9 / r.nsPerOp : 0.0;
+        r.mbPerSec = bytesPerOp > 0 ? bytesPerOp * r.opsPerSec / (1024.0 * 1024.0) : 0.0;
+        r.allocsPerOp = ops > 0 ? static_cast<double>(allocs) / ops : 0.0;
+        g_results.push_back(r);
+
+        printf("%-24s %-8s %14.1f %14.1f %14.0f %10.1f %12.3f\n", r.name.c_str(), r.unit.c_str(),
+               r.nsPerOp, r.nsPerOpMin, r.opsPerSec, r.mbPerSec, r.allocsPerOp);
+        fflush(stdout);
+    }
+
+    // 构造一帧 1664 个合法数据包，负载为固定种子的随机坐标（约 1/8 的点为零点）
+    void buildFramePackets(std::vector<Gen2Packet> &packets)
+    {
+        packets.resize(PacketsPerFrame);
+        memset(packets.data(), 0, packets.size() * sizeof(Gen2Packet));
+        uint32_t seed = 12345;
+        for (int sub = 0; sub < 32; ++sub)
+        {
+            for (int p = 0; p < 52; ++p)
+            {
+                Gen2Packet &packet = packets[sub * 52 + p];
+                const bool last = (p == 51);
+                packet.head.pktHead = htonl(0x55AA5AA5);
+                packet.head.pktLength = htons(static_cast<uint16_t>(sizeof(Gen2Packet) - 8));
+                packet.head.subFrameId = static_cast<uint8_t>(sub);
+                packet.head.startColId = static_cast<uint8_t>(last ? 255 : p * 5);
+                packet.head.endColId = static_cast<uint8_t>(last ? 255 : p * 5 + 4);
+                for (int i = 0; i < 30; ++i)
+                {
+                    Payload &payload = packet.payload[i];
+                    for (int e = 0; e < PacketConfig::EchoNumberOfPixel; ++e)
+                    {
+                        seed = seed * 1103515245u + 12345u;
+                        if ((seed >> 29) == 0)
+                        {
+                            continue;
+                        }
+                        payload.x[e] = htons(static_cast<uint16_t>(seed >> 16));
+                        payload.y[e] = htons(static_cast<uint16_t>(seed >> 8));
+                        payload.z[e] = htons(static_cast<uint16_t>(seed));
+                        payload.reflectivity[e] = static_cast<uint8_t>(seed >> 4);
+                    }
+                }
+            }
+        }
+    }
+
+    void setFrameId(std::vector<Gen2Packet> &packets, uint32_t frameId)
+    {
+        for (auto &packet : packets)
+        {
+            packet.head.frameId = htonl(frameId);
+            packet.head.pktCnt = htons(static_cast<uint16_t>(frameId));
+        }
+    }
+
+    // 负载解码内核：每个数据包的 int16 翻转、换算并写入帧网格
+    void benchDecode(const std::vector<Gen2Packet> &packets)
+    {
+        if (!selected("decode_packet"))
+        {
+            return;
+        }
+        FrameGrid grid(PacketConfig::LD_LM_LIDAR_HEIGHT, PacketConfig::LD_LM_LIDAR_WIDTH,
+                       PacketConfig::EchoNumberOfPixel);
+        const float offset[3] = {0.0f, 0.0f, 0.0f};
+        const int frames = 50;
+
+        std::vector<Sample> samples(Repeats);
+        Stopwatch sw;
+        for (int rep = 0; rep < Repeats; ++rep)
+        {
+            sw.start();
+            for (int f = 0; f < frames; ++f)
+            {
+                for (const auto &packet : packets)
+                {
+                    PayloadDecoder::decodePacket(&packet, grid, offset);
+                }
+                grid.clear();
+            }
+            sw.stop(samples[rep], static_cast<uint64_t>(frames) * packets.size());
+        }
+        addResult("decode_packet", "packet", samples, sizeof(Gen2Packet));
+    }
+
+    // PacketParser::parsePacket：每帧前 1663 个包计为 parse_packet（解码、覆盖位图、组装），
+    // 补齐一帧的最后一个包单独计为 frame_complete（含 buildPointCloud 构建整帧点云和回调）
+    void benchParser(std::vector<Gen2Packet> &packets)
+    {
+        if (!selected("parse_packet") && !selected("frame_complete"))
+        {
+            return;
+        }
+        const int frames = 30;
+        uint64_t completed = 0;
+
+        std::vector<Sample> parseSamples(Repeats);
+        std::vector<Sample> completeSamples(Repeats);
+        Stopwatch sw;
+        for (int rep = 0; rep < Repeats; ++rep)
+        {
+            PacketParser parser;
+            parser.setFrameCallback([&completed](const PointCloudLease &) { ++completed; });
+
+            uint32_t frameId = 1;
+            for (int f = -2; f < frames; ++f, ++frameId)  // 前两帧预热（点云池和网格首次触及）
+            {
+                setFrameId(packets, frameId);
+                const uint8_t *data = reinterpret_cast<const uint8_t *>(packets.data());
+
+                sw.start();
+                for (int i = 0; i < PacketsPerFrame - 1; ++i)
+                {
+                    parser.parsePacket(data + i * sizeof(Gen2Packet), sizeof(Gen2Packet));
+                }
+                if (f >= 0)
+                {
+                    sw.stop(parseSamples[rep], PacketsPerFrame - 1);
+                }
+
+                sw.start();
+                parser.parsePacket(data + (PacketsPerFrame - 1) * sizeof(Gen2Packet), sizeof(Gen2Packet));
+                if (f >= 0)
+                {
+                    sw.stop(completeSamples[rep], 1);
+                }
+            }
+        }
+        if (completed != static_cast<uint64_t>(Repeats) * (frames + 2))
+        {
+            fprintf(stderr, "解析基准: 完成帧数 %llu 与预期不符\n", static_cast<unsigned long long>(completed));
+        }
+        addResult("parse_packet", "packet", parseSamples, sizeof(Gen2Packet));
+        addResult("frame_complete", "frame", completeSamples, 0.0);
+    }
+
+    // 生产者/消费者各一个线程，比较原互斥锁环形缓冲区与 SPSC 无锁环形缓冲区的吞吐
+    // makeQueue 返回新建的队列，SPSC 队列按流水线的方式带自旋次数构造
+    template <typename Queue, typename MakeFn, typename PushFn, typename PopFn>
+    void runQueuePair(const char *name, uint64_t items, MakeFn makeQueue, PushFn pushFn, PopFn popFn)
+    {
+        if (!selected(name))
+        {
+            return;
+        }
+        std::vector<Sample> samples(Repeats);
+        Stopwatch sw;
+        for (int rep = 0; rep < Repeats; ++rep)
+        {
+            std::unique_ptr<Queue> owner(makeQueue());
+            Queue &queue = *owner;
+            std::thread consumer([&queue, items, &popFn]() {
+                uint64_t received = 0;
+                uint64_t checksum = 0;
+                while (received < items)
+                {
+                    received += popFn(queue, checksum);
+                }
+            });
+
+            sw.start();
+            for (uint64_t sent = 0; sent < items;)
+            {
+                size_t n = pushFn(queue, sent, items);
+                if (n == 0)
+                {
+                    std::this_thread::yield();
+                }
+                sent += n;
+            }
+            consumer.join();
+            sw.stop(samples[rep], items);
+        }
+        addResult(name, "item", samples, 0.0);
+    }
+
+    void benchRingBuffers()
+    {
+        const uint64_t items = 2000000;
+
+        // 原实现：互斥锁 + 条件变量，逐个 push/pop
+        runQueuePair<RingBuffer<PacketHandle>>(
+            "ring_mutex", items,
+            [] { return new RingBuffer<PacketHandle>(GlobalConfig::PacketBufferCapacity); },
+            [](RingBuffer<PacketHandle> &q, uint64_t sent, uint64_t) -> size_t {
+                return q.push(static_cast<PacketHandle>(sent)) ? 1 : 0;
+            },
+            [](RingBuffer<PacketHandle> &q, uint64_t &checksum) -> size_t {
+                PacketHandle h;
+                if (!q.pop(h))
+                {
+                    return 0;
+                }
+                checksum += h;
+                return 1;
+            });
+
+        // SPSC 队列与 ReceiveShard 中一样，消费者队空时先自旋 PacketBufferSpinCount 次再 futex 休眠
+        auto makeSpinning = [] {
+            return new SpscRingBuffer<PacketHandle>(GlobalConfig::PacketBufferCapacity,
+                                                    GlobalConfig::PacketBufferSpinCount);
+        };
+        // 不自旋、队空立即休眠的对照，衡量每个元素一次休眠/唤醒的代价
+        auto makeSleeping = [] { return new SpscRingBuffer<PacketHandle>(GlobalConfig::PacketBufferCapacity, 0); };
+
+        auto pushOne = [](SpscRingBuffer<PacketHandle> &q, uint64_t sent, uint64_t) -> size_t {
+            return q.push(static_cast<PacketHandle>(sent)) ? 1 : 0;
+        };
+        auto popOne = [](SpscRingBuffer<PacketHandle> &q, uint64_t &checksum) -> size_t {
+            PacketHandle h;
+            if (!q.pop(h))
+            {
+                return 0;
+            }
+            checksum += h;
+            return 1;
+        };
+
+        // 与接收/处理线程一样按 recvmmsg 批大小批量 push/pop
+        auto pushBatch = [](SpscRingBuffer<PacketHandle> &q, uint64_t sent, uint64_t total) -> size_t {
+            PacketHandle batch[GlobalConfig::RecvBatchSize];
+            size_t n = std::min<uint64_t>(GlobalConfig::RecvBatchSize, total - sent);
+            for (size_t i = 0; i < n; ++i)
+            {
+                batch[i] = static_cast<PacketHandle>(sent + i);
+            }
+            return q.pushBulk(batch, n);
+        };
+        auto popBatch = [](SpscRingBuffer<PacketHandle> &q, uint64_t &checksum) -> size_t {
+            PacketHandle batch[GlobalConfig::RecvBatchSize];
+            size_t n = q.popBulk(batch, GlobalConfig::RecvBatchSize);
+            for (size_t i = 0; i < n; ++i)
+            {
+                checksum += batch[i];
+            }
+            return n;
+        };
+
+        runQueuePair<SpscRingBuffer<PacketHandle>>("ring_spsc", items, makeSpinning, pushOne, popOne);
+        runQueuePair<SpscRingBuffer<PacketHandle>>("ring_spsc_bulk", items, makeSpinning, pushBatch, popBatch);
+        runQueuePair<SpscRingBuffer<PacketHandle>>("ring_spsc_nospin", items, makeSleeping, pushOne, popOne);
+        runQueuePair<SpscRingBuffer<PacketHandle>>("ring_spsc_bulk_nospin", items, makeSleeping, pushBatch, popBatch);
+    }
+
+    // 构造一整帧合成点云，坐标与实际解码结果一样是 1/512 米的整数倍
+    void fillFullFrame(PointCloud &cloud)
+    {
+        const int rows = PacketConfig::LD_LM_LIDAR_HEIGHT;
+        const int cols = PacketConfig::LD_LM_LIDAR_WIDTH;
+        const int echoes = PacketConfig::EchoNumberOfPixel;
+
+        cloud.clear();
+        cloud.points.reserve(static_cast<size_t>(rows) * cols * echoes);
+        uint32_t seed = 12345;
+        for (int r = 0; r < rows; ++r)
+        {
+            for (int c = 0; c < cols; ++c)
+            {
+                for (int e = 0; e < echoes; ++e)
+                {
+                    seed = seed * 1103515245u + 12345u;
+                    int16_t raw = static_cast<int16_t>(seed >> 16);
+                    cloud.push_back(Point3D(raw / 512.0f + 1.0f, (r - c) / 512.0f + 0.5f,
+                                            (e * 300 - raw / 4) / 512.0f, static_cast<uint8_t>(seed >> 8)));
+                }
+            }
+        }
+        cloud.frame_id = 1;
+        cloud.is_dense = false;
+    }
+
+    // 每种保存格式写出一整帧（192*256*3 = 147456 点）
+    void benchCloudWriter(const std::string &directory)
+    {
+        PointCloud cloud;
+        fillFullFrame(cloud);
+
+        struct Case {
+            CloudFormat format;
+            const char *name;
+            int iterations;
+        };
+        static const Case cases[] = {
+            {CLOUD_FORMAT_PLY_ASCII, "write_cloud_ply_ascii", 2},
+            {CLOUD_FORMAT_PLY_BINARY, "write_cloud_ply_binary", 10},
+            {CLOUD_FORMAT_PCD_BINARY, "write_cloud_pcd_binary", 10},
+        };
+
+        for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+        {
+            if (!selected(cases[i].name))
+            {
+                continue;
+            }
+            PointCloudProcessor processor;
+            processor.setSaveFormat(cases[i].format);
+
+            // 先写一次预热（创建目录、分配序列化缓冲）
+            if (!processor.WriteCloud(cloud, directory))
+            {
+                fprintf(stderr, "写出失败: %s\n", PointCloudProcessor::cloudFormatName(cases[i].format));
+                continue;
+            }
+
+            std::vector<Sample> samples(Repeats);
+            Stopwatch sw;
+            for (int rep = 0; rep < Repeats; ++rep)
+            {
+                sw.start();
+                for (int n = 0; n < cases[i].iterations; ++n)
+                {
+                    processor.WriteCloud(cloud, directory);
+                }
+                sw.stop(samples[rep], cases[i].iterations);
+            }
+            addResult(cases[i].name, "frame", samples, static_cast<double>(processor.lastWriteBytes()));
+        }
+    }
+
+    // 日志级别关闭时一条日志语句的开销（与热路径中的 LD_DEBUG 写法相同）
+    void benchLoggerDisabled()
+    {
+        if (!selected("log_disabled"))
+        {
+            return;
+        }
+        const int calls = 200000;
+        const LogLevel saved = Logger::level;
+        Logger::setLogLevel(ERROR);
+
+        std::vector<Sample> samples(Repeats);
+        Stopwatch sw;
+        for (int rep = 0; rep < Repeats; ++rep)
+        {
+            sw.start();
+            for (int i = 0; i < calls; ++i)
+            {
+                LD_DEBUG << "处理子帧: " << (i & 31) << ", 起始列: " << (i & 255);
+            }
+            sw.stop(samples[rep], calls);
+        }
+        Logger::setLogLevel(saved);
+        addResult("log_disabled", "call", samples, 0.0);
+    }
+
+    const char *archName()
+    {
+#if defined(__aarch64__)
+        return "aarch64";
+#elif defined(__x86_64__)
+        return "x86_64";
+#elif defined(__arm__)
+        return "arm";
+#else
+        return "unknown";
+#endif
+    }
+
+    // 写出 JSON 结果；字符串字段只含 ASCII 名称和标签，标签中的引号和反斜杠被替换
+    bool writeJson(const std::string &path, const std::string &label)
+    {
+        FILE *fp = fopen(path.c_str(), "w");
+        if (fp == nullptr)
+        {
+            fprintf(stderr, "无法写入结果文件: %s\n", path.c_str());
+            return false;
+        }
+
+        std::string safeLabel = label;
+        std::replace(safeLabel.begin(), safeLabel.end(), '"', '\'');
+        std::replace(safeLabel.begin(), safeLabel.end(), '\\', '/');
+
+        fprintf(fp, "{\n");
+        fprintf(fp, "  \"label\": \"%s\",\n", safeLabel.c_str());
+        fprintf(fp, "  \"version\": \"%s\",\n", GlobalConfig::Version.c_str());
+        fprintf(fp, "  \"arch\": \"%s\",\n", archName());
+        fprintf(fp, "  \"decoder\": \"%s\",\n", PayloadDecoder::backendName(PayloadDecoder::activeBackend()));
+        fprintf(fp, "  \"compiler\": \"%s\",\n", __VERSION__);
+        fprintf(fp, "  \"log_min_level\": %d,\n", LD_LOG_MIN_LEVEL);
+        fprintf(fp, "  \"repeats\": %d,\n", Repeats);
+        fprintf(fp, "  \"results\": [\n");
+        for (size_t i = 0; i < g_results.size(); ++i)
+        {
+            const BenchResult &r = g_results[i];
+            fprintf(fp, "    {\"name\": \"%s\", \"unit\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.3f, "
+                        "\"ns_per_op_min\": %.3f, \"ops_per_sec\": %.1f, \"mb_per_sec\": %.2f, "
+                        "\"allocs_per_op\": %.4f}%s\n",
+                    r.name.c_str(), r.unit.c_str(), static_cast<unsigned long long>(r.ops), r.nsPerOp,
+                    r.nsPerOpMin, r.opsPerSec, r.mbPerSec, r.allocsPerOp, i + 1 < g_results.size() ? "," : "");
+        }
+        fprintf(fp, "  ]\n}\n");
+        fclose(fp);
+        return true;
+    }
+
+    void printUsage(FILE *fp)
+    {
+        fprintf(fp, "用法: rk3576_LDlidar_bench [--json 结果文件] [--filter 名称子串] [--label 标签] "
+                    "[--dir 输出目录 | 输出目录]\n"
+                    "  输出目录用于点云写盘基准，默认 /tmp/ldlidar_bench\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // 基准测试只关心测量结果，日志只输出错误到控制台（解析器每帧的警告日志不输出）
+    Logger::setOutputType(CONSOLE_OUTPUT);
+    Logger::setLogLevel(ERROR);
+
+    std::string directory = "/tmp/ldlidar_bench";
+    std::string jsonPath;
+    std::string label;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc)
+        {
+            jsonPath = argv[++i];
+        }
+        else if (arg == "--filter" && i + 1 < argc)
+        {
+            g_filter = argv[++i];
+        }
+        else if (arg == "--label" && i + 1 < argc)
+        {
+            label = argv[++i];
+        }
+        else if (arg == "--dir" && i + 1 < argc)
+        {
+            directory = argv[++i];
+        }
+        else if (arg == "--help" || arg == "-h")
+        {
+            printUsage(stdout);
+            return 0;
+        }
+        else if (!arg.empty() && arg[0] != '-')
+        {
+            directory = arg;
+        }
+        else
+        {
+            // 未知选项或缺少参数值，不能当作输出目录，否则会把点云写到名为选项的目录中
+            fprintf(stderr, "无法识别的参数: %s\n", arg.c_str());
+            printUsage(stderr);
+            return 1;
+        }
+    }
+
+    printf("架构: %s, 解码内核: %s, 编译期日志级别: %d, 每项重复 %d 次取中位数\n", archName(),
+           PayloadDecoder::backendName(PayloadDecoder::activeBackend()), LD_LOG_MIN_LEVEL, Repeats);
+    printf("%-24s %-8s %14s %14s %14s %10s %12s\n", "基准", "单位", "ns/op(中位)", "ns/op(最小)", "op/s", "MB/s",
+           "分配/op");
+
+    std::vector<Gen2Packet> packets;
+    buildFramePackets(packets);
+
+    benchDecode(packets);
+    benchParser(packets);
+    benchRingBuffers();
+    benchCloudWriter(directory);
+    benchLoggerDisabled();
+
+    if (!jsonPath.empty() && !writeJson(jsonPath, label))
+    {
+        return 1;
+    }
+    return 0;
+}
@@ -8,6 +8,18 @@
 namespace GlobalConfig {
     const std::string Version = "1.0.0";
     constexpr int BufferSize = 2048;  // UDP缓冲区大小
+    constexpr size_t CacheLineSize = 64;  // 缓存行大小
+    constexpr int RecvBatchSize = 64;  // 单次recvmmsg最多接收的数据报数
+    constexpr int RecvStatsInterval = 16384;  // 每隔多少批次输出一次接收统计
+    constexpr bool KernelRxTimestamps = true;  // 用 SO_TIMESTAMPNS 取每个数据报的内核接收时间，关闭或不支持时用批次返回时间代替
+    constexpr int PacketBufferCapacity = 5000;  // 接收线程到处理线程的数据包队列容量
+    constexpr unsigned PacketBufferSpinCount = 2000;  // 处理线程队空时先自旋的次数，0表示直接futex休眠
+    constexpr int PacketPoolSize = PacketBufferCapacity + RecvBatchSize * 2;  // 数据包池槽位数（队列+接收批次余量）
+    constexpr int ReceiveShards = 1;  // 接收分片数（可由 --shards 指定）：每个分片独立的 SO_REUSEPORT 套接字、接收线程、数据包池、队列和解析线程
+    constexpr int MaxReceiveShards = 8;  // 接收分片数上限，通常不超过雷达数和核数
+    constexpr int RecvBufferHoldMs = 500;  // 套接字接收缓冲区按雷达数和帧率估算，至少容纳这么长时间的数据，覆盖处理线程的停顿
+    constexpr int MaxRecvBufferBytes = 64 * 1024 * 1024;  // 估算的接收缓冲区上限
+    constexpr bool KernelDropCounter = true;  // 用 SO_RXQ_OVFL 取内核因接收缓冲区满丢弃的数据包数，与用户态的丢包分开统计
 }
 
 // 雷达配置
@@ -15,11 +27,22 @@ namespace LidarConfig {
     constexpr int listenPort = 6580;  // 默认监听端口
     constexpr const char* multicastAddr = "239.255.0.1";  // 组播地址
     constexpr const char* interfaceName = "eth0";  // 接口名称
+    constexpr int FrameRate = 5;  // 雷达帧率（Hz），与雷达数一起用于估算接收缓冲区（单台约 92.7 Mb/s）
     
     // 获取配置的雷达参数列表
     std::vector<LidarParam> getLidarParams();
 }
 
+// 接收后端配置
+namespace CaptureConfig {
+    const std::string backend = "socket";     // 接收后端（可由 --capture 指定）："socket" 为 UDP 套接字，"packet" 为 AF_PACKET TPACKET_V3 环形缓冲
+    constexpr int BlockSize = 1 << 17;        // 环形缓冲块大小（页大小的整数倍），约 80 个数据报
+    constexpr int BlockCount = 128;           // 环形缓冲块数，解析线程持有的块都不能被内核复用
+    constexpr int BlockTimeoutMs = 2;         // 块未写满时最长等待多久交给用户态，限定低速率时的延迟
+    constexpr int PollTimeoutMs = 100;        // 等待新块的超时，到时检查退出标志
+    constexpr int StatsIntervalBlocks = 4096; // 每隔多少块输出一次抓包统计
+}
+
 // 雷达数据包相关常量
 namespace PacketConfig {
     constexpr int BIG_PACKET_SIZE = 1418;      // 标准数据包大小
@@ -28,6 +51,60 @@ namespace PacketConfig {
     constexpr int LD_LM_LIDAR_WIDTH = 256;     // 宽
     constexpr int LD_LM_LIDAR_HEIGHT = 192;    // 高
     constexpr int EchoNumberOfPixel = 3;       // 每个像素的回波数
+    constexpr int ROWS_PER_SUBFRAME = 6;       // 每个子帧的行数
+    constexpr int COLS_PER_PACKET = 5;         // 每个数据包的列数（最后一包只有第255列）
+}
+
+// 帧组装配置
+namespace FrameConfig {
+    constexpr int AssemblySlots = 2;           // 同时组装的帧数（双缓冲）
+    constexpr int ReorderFrameWindow = 1;      // 比最新帧旧多少个帧ID以内的帧仍可接收数据包
+    constexpr int ReorderPacketWindow = 208;   // 新帧收到这么多包后，仍未完整的旧帧被强制结束（4个子帧）
+    constexpr int LateFrameHorizon = 64;       // 帧ID落后已输出帧这么多以内视为迟到包，超出视为雷达重新计数
+    constexpr bool StreamSlices = false;       // 流式输出：每个子帧（6行）收齐后立即输出切片
+    constexpr int FlushTimeoutMs = 300;        // 帧从第一个数据包起超过该时间仍未完整则强制输出（5Hz 时一帧约 200ms）
+    constexpr int FlushCheckIntervalMs = 20;   // 处理线程空闲时检查超时帧的间隔
+}
+
+// 原始数据包录制配置
+namespace RecordConfig {
+    const bool enabled = false;               // 是否录制原始数据包（现场问题排查用）
+    const std::string path = "/usr/download/raw_packets/"; // 录制分段保存路径
+    constexpr size_t SegmentBytes = 64 * 1024 * 1024;  // 每个分段文件预分配的大小
+    constexpr int SegmentSeconds = 10;        // 每个分段最长时长，到时切换到下一个分段
+    constexpr int BlackBoxSeconds = 0;        // 黑匣子模式：大于0时只保留最近这么多秒的分段，0表示全部保留
+    constexpr int FrameIndexCapacity = 1024;  // 每个分段的帧索引条数
+}
+
+// 线程布局配置：各流水线阶段可运行的 CPU 集合和调度策略
+// CPU 集合写法："0-3,6"；"big"/"little" 按 cpu_capacity 自动识别大核/小核（RK3576 为 4×A72 + 4×A53），
+// 同构处理器上两者都是全部 CPU；空字符串表示不绑定
+namespace ThreadConfig {
+    const std::string receive_cpus = "big";   // 接收线程
+    const std::string parse_cpus = "big";     // 解析线程（含帧的点云构建）
+    const std::string writer_cpus = "little"; // 点云保存线程
+    const std::string logger_cpus = "little"; // 日志输出线程
+    constexpr int ReceivePriority = 0;        // 接收线程 SCHED_FIFO 优先级（1-99），0 表示普通调度
+    constexpr int ParsePriority = 0;          // 解析线程 SCHED_FIFO 优先级，应低于接收线程
+    const bool lock_memory = false;           // 启动时 mlockall，避免实时线程缺页
+}
+
+// 日志输出配置
+namespace LogConfig {
+    constexpr bool AsyncOutput = true;        // 由后台线程输出日志，调用线程只入队
+    constexpr int QueueCapacity = 256;        // 异步日志队列条数（2的幂），满时丢弃新日志并计数
+    constexpr int MaxMessageBytes = 2032;     // 单条日志最大字节数，超出部分截断
+    constexpr int FlushIntervalMs = 10;       // 后台线程队列为空时的休眠间隔
+    constexpr int RateWindowMs = 1000;        // 按调用点限速的窗口
+    constexpr int RateBurst = 20;             // 每个调用点每个窗口最多输出的条数，其余合并为一条"省略了 N 条"
+}
+
+// 运行指标导出配置（Prometheus 文本格式）
+namespace MetricsConfig {
+    const bool enabled = true;                // 是否导出运行指标
+    const std::string path = "/tmp/ldlidar_metrics.prom"; // 指标文件，周期性整体改写；为空表示不写文件
+    const std::string socket_path = "";       // Unix 套接字路径，非空时每个连接返回一次当前指标
+    constexpr int ExportIntervalMs = 1000;    // 指标文件刷新间隔
 }
 
 // 点云处理配置命名空间
@@ -35,6 +112,9 @@ namespace CloudConfig {
     const bool save_enabled = true;           // 是否保存点云
     const std::string save_path = "/usr/download/point_clouds/"; // 点云保存路径
     const int save_interval = 10;             // 保存间隔（帧数）
+    const std::string save_format = "ply_ascii";   // 保存格式：ply_ascii / ply_binary / pcd_binary，可由命令行第二个参数指定
+    const int save_queue_depth = 2;           // 保存队列最大深度，写盘跟不上时丢弃最旧的待保存帧
+    const int pool_size = 5;                  // 每个解析器预分配的点云缓冲数（构建中 + 最近输出 + 正在写盘 + 保存队列）
     const bool filter_enabled = true;         // 是否启用滤波
     const float filter_threshold = 0.1f;      // 滤波阈值
 }
\ No newline at end of file
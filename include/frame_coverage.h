@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+
+// 帧覆盖位图
+// 一帧由 32 个子帧 * 52 个数据包组成，每个数据包由 (subFrameId, startColId) 唯一确定，
+// 对应位图中的一个槽位。标记、查询和完整性判断都是 O(1)。
+class FrameCoverage {
+public:
+    static const int SubFrameCount = 32;        // 每帧子帧数
+    static const int PacketsPerSubFrame = 52;   // 每个子帧的数据包数
+    static const int SlotCount = SubFrameCount * PacketsPerSubFrame;  // 每帧数据包数 1664
+    static const int WordCount = (SlotCount + 63) / 64;
+
+    FrameCoverage() { clear(); }
+
+    // 由子帧ID和起始列ID计算槽位；起始列为 0,5,...,250 或 255，非法组合返回 -1
+    static int slotIndex(uint8_t subFrameId, uint8_t startColId) {
+        if (subFrameId >= SubFrameCount) {
+            return -1;
+        }
+        int colSlot;
+        if (startColId == 255) {
+            colSlot = PacketsPerSubFrame - 1;
+        } else if (startColId % 5 == 0 && startColId / 5 < PacketsPerSubFrame - 1) {
+            colSlot = startColId / 5;
+        } else {
+            return -1;
+        }
+        return subFrameId * PacketsPerSubFrame + colSlot;
+    }
+
+    // 标记槽位，返回 true 表示首次收到；重复包返回 false
+    bool mark(int slot) {
+        const uint64_t bit = 1ULL << (slot & 63);
+        uint64_t& word = words_[slot >> 6];
+        if (word & bit) {
+            return false;
+        }
+        word |= bit;
+        ++count_;
+        ++subFrameCount_[slot / PacketsPerSubFrame];
+        return true;
+    }
+
+    bool test(int slot) const {
+        return (words_[slot >> 6] >> (slot & 63)) & 1;
+    }
+
+    // 所有槽位都已收到
+    bool complete() const { return count_ == SlotCount; }
+
+    // 某个子帧的 52 个数据包是否都已收到
+    bool subFrameComplete(int subFrameId) const {
+        return subFrameCount_[subFrameId] == PacketsPerSubFrame;
+    }
+
+    // 已收到的不同数据包数
+    int count() const { return count_; }
+
+    // 某个子帧已收到的数据包数
+    int subFrameCount(int subFrameId) const { return subFrameCount_[subFrameId]; }
+
+    // 覆盖率（0~1）
+    double ratio() const { return static_cast<double>(count_) / SlotCount; }
+
+    void clear() {
+        memset(words_, 0, sizeof(words_));
+        memset(subFrameCount_, 0, sizeof(subFrameCount_));
+        count_ = 0;
+    }
+
+    // 原始位图，第 i 个槽位位于 words()[i / 64] 的第 i % 64 位
+    const uint64_t* words() const { return words_; }
+
+    // 以子帧为单位输出缺失情况，便于日志诊断，例如 "sub3:50/52 sub17:0/52"
+    std::string missingSummary() const {
+        std::string s;
+        for (int sub = 0; sub < SubFrameCount; ++sub) {
+            if (subFrameCount_[sub] == PacketsPerSubFrame) {
+                continue;
+            }
+            if (!s.empty()) {
+                s += " ";
+            }
+            s += "sub" + std::to_string(sub) + ":" + std::to_string(subFrameCount_[sub]) +
+                 "/" + std::to_string(PacketsPerSubFrame);
+        }
+        return s;
+    }
+
+private:
+    uint64_t words_[WordCount];
+    uint8_t subFrameCount_[SubFrameCount];
+    int count_;
+};
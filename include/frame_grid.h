@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include "lidar_types.h"
+
+// 帧网格：一整帧的点按 (行, 列, 回波) 存放在一块连续的对齐内存中
+// 采用结构体数组分离(SoA)的布局，x/y/z/强度/有效标志各自连续，
+// 解码时按行顺序写入，构建点云时线性扫描，避免多级 vector 的指针跳转。
+// 有效标志只在坐标非零时置位，并按行统计有效点数：构建点云和清空时跳过没有有效点的行，
+// 无效点的坐标不再读取，清空时也不必覆盖
+class FrameGrid {
+public:
+    FrameGrid(int rows, int cols, int echoes);
+    ~FrameGrid();
+
+    FrameGrid(const FrameGrid&) = delete;
+    FrameGrid& operator=(const FrameGrid&) = delete;
+
+    // 计算 (行, 列, 回波) 对应的线性下标
+    size_t index(int row, int col, int echo) const {
+        return (static_cast<size_t>(row) * cols_ + col) * echoes_ + echo;
+    }
+
+    // 写入一个点，坐标全为零的点标记为无效；返回有效标志。
+    // 调用者需用 addRowValid 累计该行的有效点数
+    uint8_t set(size_t idx, float px, float py, float pz, uint8_t pi) {
+        const uint8_t v = (px != 0.0f) | (py != 0.0f) | (pz != 0.0f);
+        x_[idx] = px;
+        y_[idx] = py;
+        z_[idx] = pz;
+        intensity_[idx] = pi;
+        valid_[idx] = v;
+        return v;
+    }
+
+    // 累计某一行新写入的有效点数
+    void addRowValid(int row, uint32_t count) {
+        rowValid_[row] += count;
+        validCount_ += count;
+    }
+
+    // 将一个点置零并标记为无效
+    void reset(size_t idx) {
+        if (valid_[idx]) {
+            --rowValid_[idx / rowStride()];
+            --validCount_;
+        }
+        x_[idx] = 0.0f;
+        y_[idx] = 0.0f;
+        z_[idx] = 0.0f;
+        intensity_[idx] = 0;
+        valid_[idx] = 0;
+    }
+
+    // 清空整帧：只清除有有效点的行的有效标志
+    void clear();
+
+    // 将 [rowBegin, rowEnd) 行的有效点按 [行][列][回波] 顺序紧凑写入 out，返回写入的点数。
+    // out 至少要能容纳这些行的有效点数再加一个点（无分支写入会在末尾多写一次）
+    size_t compactRows(int rowBegin, int rowEnd, Point3D* out) const;
+
+    // 各通道的连续数组
+    float* x() { return x_; }
+    float* y() { return y_; }
+    float* z() { return z_; }
+    uint8_t* intensity() { return intensity_; }
+    uint8_t* valid() { return valid_; }
+    const float* x() const { return x_; }
+    const float* y() const { return y_; }
+    const float* z() const { return z_; }
+    const uint8_t* intensity() const { return intensity_; }
+    const uint8_t* valid() const { return valid_; }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int echoes() const { return echoes_; }
+
+    // 每行的点数（列*回波）
+    size_t rowStride() const { return static_cast<size_t>(cols_) * echoes_; }
+
+    // 某一行 / 整帧的有效点数
+    uint32_t rowValidCount(int row) const { return rowValid_[row]; }
+    size_t validCount() const { return validCount_; }
+    size_t validCount(int rowBegin, int rowEnd) const;
+
+    // 点的总数（行*列*回波）
+    size_t size() const { return size_; }
+
+    // 占用的内存字节数
+    size_t memoryBytes() const { return bytes_; }
+
+private:
+    int rows_;
+    int cols_;
+    int echoes_;
+    size_t size_;
+    size_t bytes_;
+    uint8_t* memory_;  // 所有通道共用的一块对齐内存
+
+    float* x_;
+    float* y_;
+    float* z_;
+    uint8_t* intensity_;
+    uint8_t* valid_;
+    uint32_t* rowValid_;  // 每行的有效点数
+    size_t validCount_;
+};
@@ -5,6 +5,7 @@
 #include <string>
 #include <cstddef>
 #include <sstream>
+#include "frame_coverage.h"
 
 // 点的数据结构
 struct Point3D {
@@ -20,6 +21,17 @@ struct Point3D {
 };
 
 // 点云数据结构
+// 帧的端到端时间线，均为 CLOCK_REALTIME 纳秒（与 SO_TIMESTAMPNS 的内核接收时间同一时钟），0 表示未知
+// 下游可用 callback_ns 或自己的当前时间减去 PointCloud::timestamp（雷达GPS时间）得到传感器到消费者的延迟
+struct FrameTiming {
+    uint64_t rx_first_ns;    // 本帧最早一个数据包的内核接收时间
+    uint64_t rx_last_ns;     // 本帧最晚一个数据包的内核接收时间
+    uint64_t parse_done_ns;  // 点云构建完成的时间
+    uint64_t callback_ns;    // 交给帧回调的时间
+
+    FrameTiming() : rx_first_ns(0), rx_last_ns(0), parse_done_ns(0), callback_ns(0) {}
+};
+
 class PointCloud {
 public:
     std::vector<Point3D> points;
@@ -28,6 +40,8 @@ public:
     uint32_t width;
     bool is_dense;
     uint32_t frame_id; // 添加帧ID，用于跟踪和显示
+    FrameCoverage coverage; // 帧内数据包覆盖位图，未完整的帧可据此判断缺失区域
+    FrameTiming timing;     // 接收、构建和回调的时间线
     
     PointCloud() : timestamp(0.0), height(1), width(0), is_dense(true), frame_id(0) {}
     
@@ -55,6 +69,18 @@ public:
     }
 };
 
+// 子帧切片：一个子帧（6行）的 52 个数据包收齐后即输出，下游无需等待整帧即可开始处理
+struct PointCloudSlice {
+    std::vector<Point3D> points;
+    double timestamp;      // 该子帧第一个数据包的GPS时间（当天秒数）
+    uint32_t frame_id;     // 所属帧ID
+    uint8_t sub_frame_id;  // 子帧ID
+    uint16_t row_begin;    // 起始行（包含）
+    uint16_t row_end;      // 结束行（不包含）
+
+    PointCloudSlice() : timestamp(0.0), frame_id(0), sub_frame_id(0), row_begin(0), row_end(0) {}
+};
+
 // 雷达参数结构
 struct LidarParam {
     int index;          // 雷达索引
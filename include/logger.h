@@ -5,6 +5,8 @@
 #include <string>
 #include <chrono>
 #include <iomanip>
+#include <atomic>
+#include <stdint.h>
 #include <syslog.h>
 
 enum LogLevel {
@@ -22,43 +24,92 @@ enum LogOutputType {
     BOTH_OUTPUT
 };
 
+// 日志调用点：每条 LD_* 语句一个静态实例，用于按调用点限速
+// 每个 LogConfig::RateWindowMs 窗口内最多输出 LogConfig::RateBurst 条，其余只计数，
+// 之后合并成一条 "省略了 N 条" 输出。构造函数为 constexpr，静态实例在编译期初始化，没有初始化检查。
+struct LogSite {
+    constexpr LogSite(const char* file, int line, LogLevel level)
+        : file(file), line(line), level(level), windowStartMs(0), count(0), suppressed(0), listed(false), next(nullptr) {}
+
+    // 本条日志是否可以输出；被限速时返回false
+    bool allow();
+
+    const char* file;
+    int line;
+    LogLevel level;
+    std::atomic<uint64_t> windowStartMs;  // 当前限速窗口的开始时间（单调时钟毫秒）
+    std::atomic<uint32_t> count;          // 当前窗口内的日志条数
+    std::atomic<uint32_t> suppressed;     // 被省略、尚未报告的条数
+    std::atomic<bool> listed;             // 是否已登记到被限速调用点链表
+    std::atomic<LogSite*> next;
+};
+
 // 日志类
+// 开启异步输出后，析构时只把消息放入有界无锁队列，由后台线程格式化时间并写控制台/syslog；
+// 队列满时丢弃并计数，调用线程从不因输出而阻塞。未开启时在调用线程同步输出。
 class Logger {
 public:
     Logger(LogLevel level) : level_(level) {}
-    
+
     ~Logger();
-    
+
     template<typename T>
     Logger& operator<<(const T& value) {
         stream_ << value;
         return *this;
     }
-    
+
     // 静态成员：全局日志级别和输出类型
     static LogLevel level;
     static LogOutputType output_type;
-    
+
     // 设置全局日志级别
     static void setLogLevel(LogLevel level) {
         Logger::level = level;
     }
-    
+
     // 设置日志输出类型
     static void setOutputType(LogOutputType type) {
         Logger::output_type = type;
     }
-    
+
+    // 启动 / 停止后台输出线程；停止时先写完队列中的日志（进程退出时也会自动停止）
+    static bool startAsync();
+    static void stopAsync();
+
+    // 因队列满被丢弃的日志条数
+    static uint64_t droppedMessages();
+
+    // 输出一条已组装好的消息（异步时放入队列）
+    static void write(LogLevel level, const std::string& message);
+
 private:
     LogLevel level_;
     std::ostringstream stream_;
-    
-    std::string getLevelString(LogLevel level);
 };
 
-#define LD_TRACE Logger(TRACE)
-#define LD_DEBUG Logger(DEBUG)
-#define LD_INFO  Logger(INFO)
-#define LD_WARN  Logger(WARN)
-#define LD_ERROR Logger(ERROR)
-#define LD_FATAL Logger(FATAL)
\ No newline at end of file
+// 编译期最低日志级别（LogLevel 的数值），由 CMake 选项 LOG_MIN_LEVEL 设置
+// 低于该级别的日志语句条件恒为假，优化后整条语句被删除
+#ifndef LD_LOG_MIN_LEVEL
+#define LD_LOG_MIN_LEVEL 0
+#endif
+
+// 把 "Logger << ..." 整体变为 void，使条件运算符两侧类型一致（& 的优先级低于 <<）
+struct LogVoidify {
+    void operator&(const Logger&) {}
+};
+
+// 本条语句的调用点（lambda 内的静态实例，每条语句各一个）
+#define LD_LOG_SITE(lvl) ([]() -> LogSite* { static LogSite site(__FILE__, __LINE__, lvl); return &site; }())
+
+// 级别未开启或调用点被限速时直接短路：不构造 Logger 和 ostringstream，也不求值 << 后面的参数
+// 展开为单个表达式，可以安全地用在没有花括号的 if/else 中
+#define LD_LOG_ENABLED(lvl) ((lvl) >= LD_LOG_MIN_LEVEL && (lvl) >= Logger::level)
+#define LD_LOG(lvl) !(LD_LOG_ENABLED(lvl) && LD_LOG_SITE(lvl)->allow()) ? (void)0 : LogVoidify() & Logger(lvl)
+
+#define LD_TRACE LD_LOG(TRACE)
+#define LD_DEBUG LD_LOG(DEBUG)
+#define LD_INFO  LD_LOG(INFO)
+#define LD_WARN  LD_LOG(WARN)
+#define LD_ERROR LD_LOG(ERROR)
+#define LD_FATAL LD_LOG(FATAL)
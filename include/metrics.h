@@ -0,0 +1,146 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+
+// 单调时钟（纳秒），各阶段耗时都以它为基准
+inline uint64_t monotonicNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+// 系统时钟（纳秒），与 SO_TIMESTAMPNS 的内核接收时间同一时钟，用于帧的端到端时间线
+inline uint64_t realtimeNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+// 固定桶延迟直方图
+// 桶上界从 1us 到 1s 按 1-2.5-5 递增，最后一个桶为 +Inf。
+// observe() 只做几次比较和两次 relaxed 原子加，不加锁、不分配，可以在热路径上调用；
+// 导出线程随时读取，各桶之间不要求严格一致。
+class LatencyHistogram {
+public:
+    static const int BoundCount = 19;
+    static const uint64_t BoundsNs[BoundCount];
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void observe(uint64_t ns) {
+        int b = 0;
+        while (b < BoundCount && ns > BoundsNs[b]) {
+            ++b;
+        }
+        buckets_[b].fetch_add(1, std::memory_order_relaxed);
+        sumNs_.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    // 各桶计数（非累计），长度 BoundCount + 1
+    void snapshot(uint64_t* buckets) const;
+
+    uint64_t count() const;
+    uint64_t sumNs() const { return sumNs_.load(std::memory_order_relaxed); }
+
+    // 按桶内线性插值估计分位数，用于日志
+    double quantileNs(double q) const;
+
+private:
+    std::atomic<uint64_t> buckets_[BoundCount + 1];
+    std::atomic<uint64_t> sumNs_;
+};
+
+// 指标注册表：登记计数器、瞬时值和直方图，按 Prometheus 文本格式输出
+// 只在启动阶段注册，之后只读，导出线程无需加锁。
+class MetricsRegistry {
+public:
+    void addCounter(const std::string& name, const std::string& help, const std::atomic<uint64_t>* value);
+    void addCounter(const std::string& name, const std::string& help, std::function<double()> read);
+    void addGauge(const std::string& name, const std::string& help, std::function<double()> read);
+    void addHistogram(const std::string& name, const std::string& help, const LatencyHistogram* histogram);
+
+    // Prometheus 文本格式（exposition format 0.0.4）
+    std::string render() const;
+
+    // 各直方图的次数和 p50/p99，用于退出时的日志
+    std::string latencySummary() const;
+
+private:
+    enum Type {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    struct Entry {
+        Type type;
+        std::string name;
+        std::string help;
+        const std::atomic<uint64_t>* counter;
+        std::function<double()> gauge;
+        const LatencyHistogram* histogram;
+    };
+
+    std::vector<Entry> entries_;
+};
+
+// 流水线各阶段的指标，由各模块直接更新
+namespace Metrics {
+    extern LatencyHistogram socketWait;      // 内核接收到 recvmmsg 返回（在套接字缓冲区中的等待）
+    extern LatencyHistogram recvToEnqueue;   // recvmmsg 返回到整批放入队列
+    extern LatencyHistogram queueWait;       // 数据包从接收到被处理线程取出
+    extern LatencyHistogram parsePacket;     // 单个数据包的解析（补齐一帧时含构建和回调）
+    extern LatencyHistogram frameAssembly;   // 帧的第一个数据包到开始构建点云
+    extern LatencyHistogram cloudBuild;      // 构建整帧点云
+    extern LatencyHistogram frameCallback;   // 帧回调（交给点云处理器）
+    extern LatencyHistogram cloudSave;       // 保存线程写出一帧
+    extern LatencyHistogram rxToCallback;    // 帧最后一个数据包的内核接收到交给帧回调
+
+    extern std::atomic<uint64_t> framesEmitted;     // 输出的帧数
+    extern std::atomic<uint64_t> framesIncomplete;  // 不完整即被强制输出的帧数
+    extern std::atomic<uint64_t> framesTimedOut;    // 超时输出的帧数
+    extern std::atomic<uint64_t> packetsDuplicate;  // 重复包
+    extern std::atomic<uint64_t> packetsLate;       // 迟到包
+    extern std::atomic<uint64_t> packetsInvalid;    // 子帧/起始列无效的包
+
+    // 已登记以上指标的全局注册表，其他模块可继续添加
+    MetricsRegistry& registry();
+}
+
+// 指标导出线程
+// 每隔 intervalMs 把注册表输出写到指标文件（先写临时文件再改名，适合 node_exporter 的 textfile 收集器）；
+// 配置了 Unix 套接字时，每个连接返回一次当前指标（请求以 GET 开头时带 HTTP 响应头，可直接用 curl --unix-socket 抓取）。
+class MetricsExporter {
+public:
+    explicit MetricsExporter(const MetricsRegistry& registry);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // path 或 socketPath 为空时不使用对应的导出方式
+    bool start(const std::string& path, const std::string& socketPath, int intervalMs);
+    void stop();
+
+private:
+    void exportLoop();
+    bool writeFile();
+    void serveClient(int fd);
+
+    const MetricsRegistry& registry_;
+    std::string path_;
+    std::string socketPath_;
+    int intervalMs_;
+    int listenFd_;
+    int wakeFds_[2];    // 停止时唤醒导出线程
+    std::thread thread_;
+};
@@ -2,13 +2,31 @@
 
 #include <stdint.h>
 #include <vector>
-#include <map>
 #include <memory>
-#include <set>
+#include <chrono>
 #include <arpa/inet.h>
 #include "pktdata.h"  // 先包含数据包定义
 #include "point_cloud.h"
 #include "lidar_types.h"
+#include "frame_grid.h"
+#include "point_cloud_pool.h"
+
+// 正在组装的一帧：独立的帧网格和覆盖位图，多个槽位可同时在组装中
+struct FrameSlot {
+    FrameGrid grid;           // 本帧的点数据
+    FrameCoverage coverage;   // 本帧的覆盖位图
+    uint32_t frameId;         // 帧ID
+    int packetCount;          // 本帧收到的数据包数（包含重复包）
+    bool active;              // 是否正在组装
+    uint64_t subFrameTime[FrameCoverage::SubFrameCount];  // 各子帧第一个数据包的GPS时间（微秒）
+    std::chrono::steady_clock::time_point startTime;      // 收到第一个数据包的本地时间，用于超时输出
+    uint64_t rxFirstNs;       // 本帧数据包最早的内核接收时间（CLOCK_REALTIME 纳秒），0 表示未知
+    uint64_t rxLastNs;        // 本帧数据包最晚的内核接收时间
+
+    FrameSlot(int rows, int cols, int echoes) :
+        grid(rows, cols, echoes), frameId(0), packetCount(0), active(false), subFrameTime(),
+        rxFirstNs(0), rxLastNs(0) {}
+};
 
 // 算法参数结构
 struct AlgorithmParam {
@@ -26,11 +44,28 @@ public:
     // 设置激光雷达参数
     void setLidarParam(const LidarParam& param);
     
-    // 解析数据包，如果返回true表示一帧完成
-    bool parsePacket(const uint8_t* data, size_t size, PointCloud& cloud);
-    
-    // 获取当前点云数据
-    const PointCloud& getPointCloud() const { return frameCloud; }
+    // 设置帧完成回调，完成（或被强制结束）的帧按帧ID顺序以点云池租约的形式交给回调
+    void setFrameCallback(PointCloudLeaseCallback callback) { frameCallback_ = callback; }
+
+    // 设置子帧切片回调（流式模式）；设置后每个子帧的 52 个数据包收齐即输出该子帧的切片
+    void setSliceCallback(PointCloudSliceCallback callback) { sliceCallback_ = callback; }
+
+    // 解析数据包，如果返回true表示本次至少有一帧完成并已交给回调
+    // rxTimeNs 为数据包的内核接收时间（CLOCK_REALTIME 纳秒），0 表示未知
+    bool parsePacket(const uint8_t* data, size_t size, uint64_t rxTimeNs = 0);
+
+    // 强制结束所有正在组装的帧（例如退出前）
+    int flush();
+
+    // 结束从第一个数据包起已超过 FrameConfig::FlushTimeoutMs 的帧，返回结束的帧数
+    // 由处理线程周期性调用，接收空闲（雷达停止或链路中断）时也能按时输出
+    int flushExpired(std::chrono::steady_clock::time_point now);
+
+    // 获取最近一次输出的点云数据
+    const PointCloudLease& getPointCloud() const { return lastCloud_; }
+
+    // 点云缓冲池（统计用）
+    PointCloudPool& cloudPool() { return cloudPool_; }
     
     // 添加设置调试模式的功能
     void setDebugMode(bool enabled) { debugMode = enabled; }
@@ -43,7 +78,22 @@ public:
     
 private:
     // 解析数据包并更新点云
-    void processPacket(const Gen2Packet* packet);
+    void processPacket(FrameSlot& slot, const Gen2Packet* packet);
+
+    // 查找帧ID对应的组装槽位，不存在时占用一个空闲槽位（必要时先结束最旧的帧）
+    FrameSlot* acquireSlot(uint32_t frameId, int& emitted);
+
+    // 结束一帧：构建点云、交给回调并释放槽位
+    void finalizeSlot(FrameSlot& slot);
+
+    // 按重排窗口结束比 newest 旧的帧（force 时全部结束），按帧ID顺序输出，返回结束的帧数
+    int finalizeOlderThan(const FrameSlot& newest, bool force);
+
+    // 正在组装的帧中帧ID最旧的一个，没有时返回nullptr
+    FrameSlot* oldestActiveSlot();
+
+    // 帧ID是否属于已经输出过的帧（迟到包）
+    bool isLateFrame(uint32_t frameId) const;
     
     // 检查是否为有效的消息格式
     bool isValidMessage(size_t size);
@@ -52,40 +102,45 @@ private:
     bool isFrameEnd(const Gen2Packet* packet);
     
     // 构建点云
-    void buildPointCloud(PointCloud& cloud);
+    void buildPointCloud(const FrameSlot& slot, PointCloud& cloud);
+
+    // 构建一个子帧的切片并交给切片回调
+    void emitSlice(const FrameSlot& slot, int subFrameId);
     
-    // 转换点的坐标
-    void transformPoint(float& x, float& y, float& z);
+    // 按回波选择算法过滤刚解码的数据包（仅在启用点云过滤时使用）
+    void applyEchoFilter(FrameGrid& grid, const Gen2Packet* packet);
     
     // 算法参数
     AlgorithmParam algorithmParam;
     
     LidarParam lidarParam;  // 激光雷达参数
-    PointCloud frameCloud;  // 当前帧点云
-    uint32_t currentFrameId;  // 当前帧ID
-    bool frameInProgress;  // 是否正在处理中的帧
-    
-    // 点云缓存，存储所有点
-    std::vector<Point3D> points;
+    float offset_[3];       // 外参平移 (x, y, z)
+    PointCloudPool cloudPool_;          // 帧点云缓冲池，输出的帧构建在回收的缓冲中
+    PointCloudLease lastCloud_;         // 最近输出的帧点云
+    PointCloudLeaseCallback frameCallback_;  // 帧完成回调
+    PointCloudSlice sliceCloud_;        // 最近输出的子帧切片，复用其点缓冲
+    PointCloudSliceCallback sliceCallback_;  // 子帧切片回调
     
     // 当前点云的宽度、高度
     int cloudWidth;
     int cloudHeight;
     
-    // 用于判断帧是否完整的计数器
-    int packetCount;
-    
     // 处理点的计数器
     uint64_t processed_points_;
     
-    // 记录当前帧的所有subFrameId和startColId
-    std::set<std::pair<uint8_t, uint8_t>> receivedSubframes;
-    
-    // 跟踪每帧包数
-    std::map<uint32_t, int> packets_;
-    
-    // 3D点云数据存储 [行][列][回波]
-    std::vector<std::vector<std::vector<Point3D>>> pointData_;
+    // 帧组装槽位，每个槽位一块帧网格，按 [行][列][回波] 连续存储的 SoA 点数据
+    std::vector<std::unique_ptr<FrameSlot>> slots_;
+
+    // 最近输出的帧ID，用于识别迟到包
+    uint32_t lastFinalizedId_ = 0;
+    bool hasFinalized_ = false;
+
+    // 重复包、无效包、迟到包、被强制结束的帧和超时输出的帧计数
+    uint64_t duplicatePackets_ = 0;
+    uint64_t invalidPackets_ = 0;
+    uint64_t latePackets_ = 0;
+    uint64_t incompleteFrames_ = 0;
+    uint64_t timeoutFrames_ = 0;
     
     bool debugMode = false; // 调试模式开关
     
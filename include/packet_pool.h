@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <atomic>
+#include "config.h"
+#include "spsc_ring_buffer.h"
+
+// 数据包槽位：接收线程直接写入，解析线程原地读取
+struct alignas(GlobalConfig::CacheLineSize) PacketSlot {
+    uint8_t data[PacketConfig::BIG_PACKET_SIZE];  // 原始UDP负载
+    uint16_t length;                              // 实际接收长度
+    uint32_t ipaddr;                              // 来源IP最后一段
+    uint64_t enqueueTimeNs;                       // 接收批次返回时的单调时钟时间，用于统计排队等待
+    uint64_t rxTimeNs;                            // 内核接收时间（CLOCK_REALTIME 纳秒），随数据包带入帧
+    const uint8_t* payload;                       // 解析读取的负载：默认指向 data，AF_PACKET 抓包时直接指向环形缓冲
+    std::atomic<uint32_t>* ringRefs;              // 负载所在环形缓冲块的引用计数，解析完后减一；不在环形缓冲中时为空
+};
+
+// 槽位句柄，队列中只传递句柄
+typedef uint32_t PacketHandle;
+constexpr PacketHandle InvalidPacketHandle = 0xFFFFFFFFu;
+
+// 固定槽位数据包池
+// 所有槽位在构造时一次性分配，运行期间不再进行堆分配。
+// 空闲槽位保存在 SPSC 队列中：处理线程归还，接收线程申请。
+class PacketPool {
+public:
+    explicit PacketPool(size_t capacity);
+    ~PacketPool();
+
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    // 申请一个空闲槽位，池已耗尽时返回false
+    bool acquire(PacketHandle& handle);
+
+    // 批量申请空闲槽位，返回实际申请到的数量
+    size_t acquireBulk(PacketHandle* handles, size_t count);
+
+    // 归还槽位
+    void release(PacketHandle handle);
+
+    // 批量归还槽位
+    void releaseBulk(const PacketHandle* handles, size_t count);
+
+    PacketSlot& slot(PacketHandle handle) { return slots_[handle]; }
+    const PacketSlot& slot(PacketHandle handle) const { return slots_[handle]; }
+
+    size_t capacity() const { return capacity_; }
+
+    // 当前空闲槽位数
+    size_t available() const;
+
+private:
+    PacketSlot* slots_;
+    size_t capacity_;
+    SpscRingBuffer<PacketHandle> freeList_;  // 空闲槽位队列
+};
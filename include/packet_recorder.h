@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "raw_record_format.h"
+
+// 原始数据包录制器
+// 把每个数据报连同源IP和接收时间追加到预分配、已映射的分段文件中（格式见 raw_record_format.h）。
+// 接收线程只做一次 memcpy 和指针推进；创建并映射下一个分段、收尾已写满的分段、
+// 黑匣子模式下删除过期分段都在后台线程中完成，不阻塞实时接收路径。
+// 下一个分段尚未就绪时当条记录被丢弃并计数，接收本身不受影响。
+class PacketRecorder {
+public:
+    // segmentBytes: 每个分段的大小；segmentSeconds: 分段最长时长；
+    // blackBoxSeconds: 大于0时只保留最近这么多秒的分段（黑匣子模式）
+    PacketRecorder(const std::string& directory, size_t segmentBytes, int segmentSeconds,
+                   int blackBoxSeconds, int frameIndexCapacity);
+    ~PacketRecorder();
+
+    PacketRecorder(const PacketRecorder&) = delete;
+    PacketRecorder& operator=(const PacketRecorder&) = delete;
+
+    // 创建目录和第一个分段并启动后台线程
+    bool start();
+
+    // 收尾当前分段并停止后台线程
+    void stop();
+
+    // 记录一个数据报（只能由接收线程调用）
+    void record(const uint8_t* data, size_t length, uint32_t sourceIp, uint64_t timeNs);
+
+    // 统计
+    uint64_t recordCount() const { return records_.load(std::memory_order_relaxed); }
+    uint64_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+    std::string statsString() const;
+
+private:
+    // 一个已映射的分段文件
+    struct Segment {
+        int fd;
+        uint8_t* base;
+        size_t size;
+        size_t used;           // 已使用的字节数（含文件头）
+        uint32_t sequence;
+        std::string path;
+    };
+
+    // 最近一个帧ID，用于判断是否需要新增帧索引
+    struct LastFrame {
+        uint32_t sourceIp;
+        uint32_t frameId;
+    };
+    static const int LastFrameSlots = 16;
+
+    // 后台线程
+    void helperLoop();
+
+    // 创建并映射一个新分段
+    Segment* createSegment(uint32_t sequence);
+
+    // 收尾分段：截断到已用大小、解除映射并关闭，黑匣子模式下记录以便过期删除
+    void closeSegment(Segment* segment);
+
+    // 当前分段写满或到时，换成后台准备好的下一个分段；没有就绪分段时返回false
+    bool rotate();
+
+    RawRecord::RawSegmentHeader* header(Segment* segment) const {
+        return reinterpret_cast<RawRecord::RawSegmentHeader*>(segment->base);
+    }
+
+    void addFrameIndex(Segment* segment, uint64_t offset, uint64_t timeNs, uint32_t frameId, uint32_t sourceIp);
+
+    const std::string directory_;
+    const size_t segmentBytes_;
+    const uint64_t segmentNs_;
+    const int blackBoxSeconds_;
+    const int frameIndexCapacity_;
+    const size_t headerBytes_;
+    std::string sessionName_;          // 分段文件名前缀（启动时间）
+
+    // 接收线程独占
+    Segment* current_;
+    uint64_t currentStartNs_;
+    LastFrame lastFrames_[LastFrameSlots];
+    int lastFrameCount_;
+
+    // 接收线程与后台线程之间的交接
+    std::atomic<Segment*> ready_;      // 后台准备好的下一个分段
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<Segment*> retired_;     // 待收尾的分段
+    bool needSegment_;
+    bool stopping_;
+    uint32_t nextSequence_;
+    std::thread helper_;
+
+    // 黑匣子模式：已收尾的分段（路径、最后记录时间），只在后台线程中访问
+    std::deque<std::pair<std::string, uint64_t> > closed_;
+
+    std::atomic<uint64_t> records_;
+    std::atomic<uint64_t> bytes_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> segments_;
+    std::atomic<uint64_t> deleted_;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+// 环形缓冲中的一个 UDP 数据报
+struct RingPacket {
+    const uint8_t* data;    // UDP 负载，直接指向内核共享的环形缓冲
+    uint16_t length;        // 负载长度
+    uint32_t sourceAddr;    // 来源 IPv4 地址（主机字节序）
+    uint64_t rxTimeNs;      // 内核接收时间（CLOCK_REALTIME 纳秒）
+    bool truncated;         // 抓取长度小于数据报长度
+};
+
+// 抓包统计信息
+struct PacketRingStats {
+    uint64_t polls;         // poll 调用次数
+    uint64_t blocks;        // 取到的块数
+    uint64_t packets;       // 取到的数据报数
+    uint64_t skipped;       // 不是完整 UDP 数据报而被跳过的帧数
+    uint64_t kernelPackets; // 内核统计的抓包数（PACKET_STATISTICS）
+    uint64_t kernelDrops;   // 环形缓冲没有空闲块时内核丢弃的数据包数
+    uint64_t freezes;       // 内核因环形缓冲占满而冻结队列的次数
+    uint32_t maxHeld;       // 同时未归还内核的最大块数
+
+    PacketRingStats() : polls(0), blocks(0), packets(0), skipped(0), kernelPackets(0), kernelDrops(0),
+                        freezes(0), maxHeld(0) {}
+};
+
+// 基于 AF_PACKET TPACKET_V3 的抓包接收器
+// 内核把目的端口匹配的 IPv4 UDP 数据报（BPF 过滤）写入映射到用户态的块环形缓冲，
+// 块写满或超时后整块交给用户态。数据报不经过 UDP 协议栈，也没有逐包的系统调用和拷贝：
+// 解析线程直接读取块中的负载，块中所有被持有的数据报都解析完后才把块归还内核。
+// 除 hold 返回的引用计数外，所有接口只能在同一个线程中调用。
+class PacketRing {
+public:
+    PacketRing(int blockSize, int blockCount, int blockTimeoutMs);
+    ~PacketRing();
+
+    PacketRing(const PacketRing&) = delete;
+    PacketRing& operator=(const PacketRing&) = delete;
+
+    // 在网络接口上打开抓包套接字，只接收目的端口为 port 的 IPv4 UDP 数据报；失败时返回false并保留 errno
+    bool open(const std::string& interface, int port);
+
+    // 在接口上加入 IPv4 组播组对应的链路层组播地址，使网卡接收该组的数据
+    bool joinMulticast(const std::string& interface, const char* group);
+
+    // 等待下一个已交给用户态的块并取出其中的数据报，返回数据报数量；超时返回 0，出错返回 -1 并保留 errno
+    // 上一个块中没有被持有的数据报在这里失效
+    int nextBlock(int timeoutMs);
+
+    const RingPacket& packet(int i) const { return packets_[i]; }
+
+    // 持有本块的第 i 个数据报，返回所在块的引用计数；使用者读完负载后把计数减一（release 语义）
+    std::atomic<uint32_t>* hold(int i);
+
+    // 按顺序把已取完且引用计数归零的块归还内核
+    void releaseBlocks();
+
+    // 读取并累加内核的抓包和丢包计数，返回自上次读取以来内核丢弃的数据包数
+    uint64_t updateKernelStats();
+
+    const PacketRingStats& stats() const { return stats_; }
+
+    // 统计信息的可读描述，用于日志输出
+    std::string statsString() const;
+
+    size_t bufferBytes() const { return static_cast<size_t>(blockSize_) * blockCount_; }
+
+private:
+    void close();
+    uint8_t* block(int index) const { return map_ + static_cast<size_t>(index) * blockSize_; }
+
+    int fd_;
+    uint8_t* map_;
+    int blockSize_;
+    int blockCount_;
+    int blockTimeoutMs_;
+    int current_;           // 下一个要读取的块
+    int oldest_;            // 最早一个未归还内核的块
+    int held_;              // 已读取、尚未归还内核的块数
+    std::unique_ptr<std::atomic<uint32_t>[]> refs_;  // 各块被解析线程持有的数据报数
+    std::vector<RingPacket> packets_;  // 当前块中的数据报
+    PacketRingStats stats_;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include "pktdata.h"
+#include "frame_grid.h"
+
+// 数据包负载解码内核
+// 将一个 Gen2Packet 的 30 个负载一次性完成：int16 字节序翻转、/512 换算、
+// 外参平移，并写入帧网格。RK3576 上使用 NEON，x86 测试机上使用 SSE2，
+// 其他平台退回标量实现；所有实现与标量参考路径逐位一致。
+namespace PayloadDecoder {
+
+    enum Backend {
+        BACKEND_SCALAR,
+        BACKEND_SSE2,
+        BACKEND_NEON
+    };
+
+    // 当前生效的解码实现
+    Backend activeBackend();
+    const char* backendName(Backend backend);
+
+    // 强制使用标量实现（自检失败或调试时使用）
+    void setScalarOnly(bool scalarOnly);
+
+    // 解码一个数据包写入帧网格，offset 为 x/y/z 外参平移，返回写入的点数
+    size_t decodePacket(const Gen2Packet* packet, FrameGrid& grid, const float offset[3]);
+
+    // 标量参考实现，与原逐回波解码路径保持逐位一致
+    size_t decodePacketScalar(const Gen2Packet* packet, FrameGrid& grid, const float offset[3]);
+
+    // 用合成数据包比较向量实现与标量实现的输出是否逐位一致
+    bool selfCheck();
+}
@@ -2,8 +2,15 @@
 #define POINT_CLOUD_H
 
 #include "lidar_types.h"
+#include "point_cloud_pool.h"
 #include <functional>
 #include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdint.h>
 #include <fstream>
 #include <ctime>
 #include <iomanip>
@@ -17,9 +24,22 @@ struct pc_pkt_t {
     uint8_t intensity;
 };
 
+// 点云保存格式
+enum CloudFormat {
+    CLOUD_FORMAT_PLY_ASCII,     // ASCII PLY，逐个数值格式化输出
+    CLOUD_FORMAT_PLY_BINARY,    // binary_little_endian PLY
+    CLOUD_FORMAT_PCD_BINARY     // binary PCD
+};
+
 // 点云处理回调函数类型
 typedef std::function<void(const PointCloud&)> PointCloudCallback;
 
+// 帧完成回调函数类型：以租约形式交付，持有者可在回调返回后继续使用该帧
+typedef std::function<void(const PointCloudLease&)> PointCloudLeaseCallback;
+
+// 子帧切片回调函数类型（流式输出）
+typedef std::function<void(const PointCloudSlice&)> PointCloudSliceCallback;
+
 class PointCloudProcessor {
 public:
     PointCloudProcessor();
@@ -28,8 +48,24 @@ public:
     // 设置点云处理回调
     void setCallback(PointCloudCallback callback);
     
-    // 处理点云数据
-    void processCloud(const PointCloud& cloud);
+    // 设置子帧切片回调
+    void setSliceCallback(PointCloudSliceCallback callback);
+
+    // 启动 / 停止保存线程；停止时先写完队列中剩余的帧
+    void start();
+    void stop();
+
+    // 处理点云数据（点云缓冲来自点云池，不复制）
+    // 按 CloudConfig::save_interval 每隔 N 帧把一帧放入保存队列，由保存线程写盘
+    void processCloud(const PointCloudLease& cloud);
+
+    // 保存统计
+    uint64_t savedFrames() const { return saved_.load(std::memory_order_relaxed); }
+    uint64_t droppedSaves() const { return dropped_.load(std::memory_order_relaxed); }
+    std::string saveStatsString() const;
+
+    // 处理流式输出的子帧切片（不保存文件，直接交给切片回调）
+    void processSlice(const PointCloudSlice& slice);
     
     // 设置是否有新一帧点云的标志
     void setNewFrameFlag(bool is_new_frame) {
@@ -47,13 +83,61 @@ public:
     // 将点云写入文件（重载版本，修改参数顺序）
     bool WriteCloud(const PointCloud& cloud, const std::string& directory);
 
+    // 最近一次 WriteCloud 写出的文件字节数
+    size_t lastWriteBytes() const { return last_write_bytes_; }
+
+    // 设置保存格式（在 start 之前调用）
+    void setSaveFormat(CloudFormat format);
+    CloudFormat saveFormat() const { return save_format_; }
+
+    // 格式名（ply_ascii / ply_binary / pcd_binary）与枚举互转
+    static const char* cloudFormatName(CloudFormat format);
+    static bool parseCloudFormat(const std::string& name, CloudFormat& format);
+
+    // 把文件头和全部点序列化到一块连续缓冲（二进制 PLY / PCD），返回总字节数
+    static size_t serializeBinary(const PointCloud& cloud, CloudFormat format, std::vector<char>& buffer);
+
+    // 二进制格式中每个点的字节数：x, y, z (float) + 强度 (uchar)
+    static const size_t BinaryPointSize = sizeof(float) * 3 + 1;
+
     // 确保目录存在
     static bool ensureDirectoryExists(const std::string& path);
 
 private:
+    // 放入保存队列，队满时丢弃最旧的一帧
+    void enqueueSave(const PointCloudLease& cloud);
+
+    // 保存线程：从队列取帧写盘
+    void writerLoop();
+
+    // 按格式写出一帧，返回有效点数和文件字节数
+    bool writeAscii(const PointCloud& cloud, const std::string& filename, int& valid_count, size_t& bytes);
+    bool writeBinary(const PointCloud& cloud, const std::string& filename, int& valid_count, size_t& bytes);
+
     PointCloudCallback callback_;
+    PointCloudSliceCallback sliceCallback_;
     int file_index_;
     bool is_new_frame_; // 标记当前点云是否为新的一帧
+    CloudFormat save_format_;        // 保存格式
+    std::vector<char> writeBuffer_;  // 二进制格式的序列化缓冲，只在保存线程中使用
+    size_t last_write_bytes_;
+
+    // 保存队列：固定容量的环形队列，由 saveMutex_ 保护
+    std::vector<PointCloudLease> saveQueue_;
+    size_t saveHead_;
+    size_t saveCount_;
+    bool saveStop_;
+    std::mutex saveMutex_;
+    std::condition_variable saveCond_;
+    std::thread writerThread_;
+    std::atomic<uint64_t> frameCount_;  // 多个分片的解析线程都会调用 processCloud
+
+    // 保存统计：已保存、因队满丢弃、写盘耗时（微秒）
+    std::atomic<uint64_t> saved_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> writeTotalUs_;
+    std::atomic<uint64_t> writeMaxUs_;
+    std::atomic<uint64_t> writeLastUs_;
 };
 
 #endif // POINT_CLOUD_H
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "lidar_types.h"
+
+class PointCloudPool;
+
+// 池中的一个点云缓冲及其引用计数
+struct PooledPointCloud {
+    PointCloud cloud;
+    std::atomic<int> refs;
+    PointCloudPool* pool;
+
+    PooledPointCloud() : refs(0), pool(nullptr) {}
+};
+
+// 点云租约：引用计数的点云句柄，复制租约只增加计数，不复制点数据。
+// 最后一个租约释放时点云缓冲回到池中，可以跨线程传递和释放
+class PointCloudLease {
+public:
+    PointCloudLease() : entry_(nullptr) {}
+    explicit PointCloudLease(PooledPointCloud* entry) : entry_(entry) {}
+
+    PointCloudLease(const PointCloudLease& other) : entry_(other.entry_) {
+        if (entry_) {
+            entry_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    PointCloudLease(PointCloudLease&& other) : entry_(other.entry_) {
+        other.entry_ = nullptr;
+    }
+
+    PointCloudLease& operator=(const PointCloudLease& other) {
+        if (this != &other) {
+            PointCloudLease tmp(other);
+            std::swap(entry_, tmp.entry_);
+        }
+        return *this;
+    }
+
+    PointCloudLease& operator=(PointCloudLease&& other) {
+        if (this != &other) {
+            reset();
+            entry_ = other.entry_;
+            other.entry_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~PointCloudLease() { reset(); }
+
+    // 放弃本租约，计数归零时归还缓冲
+    void reset();
+
+    PointCloud* get() const { return entry_ ? &entry_->cloud : nullptr; }
+    PointCloud& operator*() const { return entry_->cloud; }
+    PointCloud* operator->() const { return &entry_->cloud; }
+    explicit operator bool() const { return entry_ != nullptr; }
+
+    // 当前持有该缓冲的租约数
+    int useCount() const {
+        return entry_ ? entry_->refs.load(std::memory_order_relaxed) : 0;
+    }
+
+private:
+    PooledPointCloud* entry_;
+};
+
+// 点云对象池：预先分配若干个容量足够一整帧的点云缓冲，
+// 解析器把帧构建进回收的缓冲，稳态运行时不再分配内存。
+// 池必须比它发出的所有租约活得更久
+class PointCloudPool {
+public:
+    PointCloudPool(size_t count, size_t pointCapacity);
+    ~PointCloudPool();
+
+    PointCloudPool(const PointCloudPool&) = delete;
+    PointCloudPool& operator=(const PointCloudPool&) = delete;
+
+    // 取出一个空的点云缓冲；池空时额外分配一个并计数
+    PointCloudLease acquire();
+
+    // 池中缓冲总数 / 空闲缓冲数
+    size_t capacity();
+    size_t available();
+
+    // 因池空而额外分配的次数
+    uint64_t overflowCount() const { return overflow_.load(std::memory_order_relaxed); }
+
+private:
+    friend class PointCloudLease;
+
+    // 新建一个预留好容量的缓冲并加入池（需持有 mutex_）
+    PooledPointCloud* createEntry();
+
+    // 最后一个租约释放时调用
+    void recycle(PooledPointCloud* entry);
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<PooledPointCloud>> entries_;
+    std::vector<PooledPointCloud*> free_;
+    size_t pointCapacity_;
+    std::atomic<uint64_t> overflow_;
+};
+
+inline void PointCloudLease::reset() {
+    if (entry_ && entry_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        entry_->pool->recycle(entry_);
+    }
+    entry_ = nullptr;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+// 原始数据包录制文件格式（小端）
+//
+// 每个分段文件由固定大小的文件头（含帧索引）和数据区组成：
+//   [RawSegmentHeader][RawFrameIndexEntry * frameIndexCapacity][填充到 headerBytes]
+//   [RawRecordHeader][数据报][填充到 8 字节] ...
+// 录制过程中文件头随每条记录更新，即使程序异常退出，已写入的记录也可以读出。
+namespace RawRecord {
+
+    constexpr char Magic[8] = {'L', 'D', 'R', 'A', 'W', 'S', 'E', 'G'};
+    constexpr uint32_t Version = 1;
+    constexpr size_t RecordAlign = 8;
+
+    struct RawSegmentHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerBytes;          // 文件头（含帧索引）字节数，数据区从这里开始
+        uint64_t segmentBytes;         // 分段文件预分配的字节数
+        uint64_t dataBytes;            // 数据区已使用的字节数
+        uint64_t firstTimeNs;          // 第一条记录的接收时间
+        uint64_t lastTimeNs;           // 最后一条记录的接收时间
+        uint32_t recordCount;          // 记录条数
+        uint32_t sequence;             // 分段序号
+        uint32_t frameIndexCapacity;   // 帧索引容量
+        uint32_t frameIndexCount;      // 已使用的帧索引条数
+    };
+
+    // 帧索引：某个雷达的一个新帧ID在本分段中第一次出现的位置
+    struct RawFrameIndexEntry {
+        uint64_t offset;               // 该记录相对数据区起点的偏移
+        uint64_t timeNs;               // 接收时间
+        uint32_t frameId;
+        uint32_t sourceIp;             // 源IPv4地址（主机字节序）
+    };
+
+    // 每条记录的头
+    struct RawRecordHeader {
+        uint64_t timeNs;               // 接收时间（CLOCK_REALTIME，纳秒）
+        uint32_t sourceIp;             // 源IPv4地址（主机字节序）
+        uint16_t length;               // 数据报字节数
+        uint16_t reserved;
+    };
+
+    static_assert(sizeof(RawSegmentHeader) == 64, "RawSegmentHeader 布局变化");
+    static_assert(sizeof(RawFrameIndexEntry) == 24, "RawFrameIndexEntry 布局变化");
+    static_assert(sizeof(RawRecordHeader) == 16, "RawRecordHeader 布局变化");
+
+    // 一条记录（含填充）占用的字节数
+    inline size_t recordBytes(size_t length) {
+        return (sizeof(RawRecordHeader) + length + RecordAlign - 1) & ~(RecordAlign - 1);
+    }
+
+    // 文件头字节数：按页对齐，数据区从页边界开始
+    inline size_t headerBytes(size_t frameIndexCapacity) {
+        const size_t bytes = sizeof(RawSegmentHeader) + frameIndexCapacity * sizeof(RawFrameIndexEntry);
+        return (bytes + 4095) & ~static_cast<size_t>(4095);
+    }
+}
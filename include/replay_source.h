@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 回放的一个数据报，data 指向映射的文件，在下一次 next() 之前有效
+struct ReplayPacket {
+    const uint8_t* data;
+    size_t length;
+    uint32_t sourceIp;     // 源IPv4地址（主机字节序）
+    uint64_t timeNs;       // 录制时的接收时间（纳秒）
+};
+
+// 离线回放数据源
+// 按给定顺序只读映射录制文件，逐个取出其中的雷达数据报，不做额外拷贝。支持：
+//   - 本程序录制的原始数据包分段（.ldraw，格式见 raw_record_format.h）
+//   - 经典 pcap 文件（微秒/纳秒时间戳，任意字节序），链路类型为以太网（含 VLAN）、
+//     Linux cooked capture（SLL/SLL2）或原始IP；只取目的端口为指定端口的 IPv4 UDP 数据报，
+//     IP 分片和截断的抓包记录跳过并计数
+class ReplaySource {
+public:
+    explicit ReplaySource(int port);
+    ~ReplaySource();
+
+    ReplaySource(const ReplaySource&) = delete;
+    ReplaySource& operator=(const ReplaySource&) = delete;
+
+    // 检查并记录要回放的文件，任一文件无法识别时返回false
+    bool open(const std::vector<std::string>& paths);
+
+    // 取出下一个数据报，全部文件读完时返回false
+    bool next(ReplayPacket& packet);
+
+    // 已取出的数据报数和跳过的记录数（非目标端口、分片、截断等）
+    uint64_t packetCount() const { return packets_; }
+    uint64_t skippedCount() const { return skipped_; }
+
+private:
+    enum FileKind {
+        KIND_RAW,
+        KIND_PCAP
+    };
+
+    // 识别文件类型，失败返回false
+    static bool probe(const std::string& path, FileKind& kind);
+
+    // 映射第 index 个文件并定位到第一条记录
+    bool mapFile(size_t index);
+    void unmapFile();
+
+    // 从当前文件取下一个数据报，文件读完时返回false
+    bool nextRaw(ReplayPacket& packet);
+    bool nextPcap(ReplayPacket& packet);
+
+    // 从一条 pcap 记录中提取 UDP 负载，不是目标数据报时返回false
+    bool extractUdp(const uint8_t* frame, size_t length, ReplayPacket& packet) const;
+
+    uint32_t pcap32(const uint8_t* p) const;
+
+    int port_;
+    std::vector<std::string> paths_;
+    std::vector<FileKind> kinds_;
+    size_t fileIndex_;
+
+    // 当前映射的文件
+    int fd_;
+    const uint8_t* base_;
+    size_t size_;
+    size_t offset_;    // 下一条记录的位置
+    size_t end_;       // 有效数据的结束位置
+
+    // pcap 文件参数
+    bool pcapSwapped_;
+    bool pcapNano_;
+    uint32_t linkType_;
+
+    uint64_t packets_;
+    uint64_t skipped_;
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "config.h"
+
+// 单生产者/单消费者无锁环形缓冲区
+// 接口与 RingBuffer<T> 保持一致，只允许一个线程 push、一个线程 pop。
+// 队空时消费者先自旋 spinCount 次，仍无数据则在 futex 上休眠，
+// 生产者只在消费者确实休眠时才发起唤醒系统调用。
+template <typename T>
+class SpscRingBuffer {
+public:
+    explicit SpscRingBuffer(size_t capacity, unsigned spinCount = 0) :
+        capacity_(capacity),
+        mask_(roundUpPow2(capacity) - 1),
+        buffer_(mask_ + 1),
+        spinCount_(spinCount),
+        head_(0),
+        tailCache_(0),
+        highWater_(0),
+        tail_(0),
+        headCache_(0),
+        sleeping_(0),
+        futexWord_(0),
+        sleeps_(0),
+        exit_(false) {}
+
+    // 生产者：放入一个元素，队满返回false
+    bool push(const T& item) {
+        return pushBulk(&item, 1) == 1;
+    }
+
+    // 生产者：批量放入，返回实际放入的数量
+    size_t pushBulk(const T* items, size_t count) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t free = capacity_ - (tail - headCache_);
+        if (free < count) {
+            // 本地缓存的 head 过旧时才读取消费者的缓存行
+            headCache_ = head_.load(std::memory_order_acquire);
+            free = capacity_ - (tail - headCache_);
+        }
+        const size_t n = count < free ? count : free;
+        if (n == 0) {
+            return 0;
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            buffer_[(tail + i) & mask_] = items[i];
+        }
+        tail_.store(tail + n, std::memory_order_release);
+
+        wakeConsumer();
+        return n;
+    }
+
+    // 消费者：阻塞直到取出一个元素；退出且队空时返回false
+    bool pop(T& item) {
+        return popBulk(&item, 1) == 1;
+    }
+
+    // 消费者：阻塞直到至少取出一个元素，最多取 maxCount 个；退出且队空时返回0
+    size_t popBulk(T* items, size_t maxCount) {
+        for (;;) {
+            size_t n = tryPopBulk(items, maxCount);
+            if (n > 0) {
+                return n;
+            }
+            if (exit_.load(std::memory_order_acquire)) {
+                // 退出前再取一次，避免丢掉最后放入的数据
+                return tryPopBulk(items, maxCount);
+            }
+            waitForData();
+        }
+    }
+
+    // 消费者：最多等待 timeoutMs 毫秒，取出至少一个元素；超时或退出且队空时返回0
+    size_t popBulkFor(T* items, size_t maxCount, int timeoutMs) {
+        const int64_t deadline = monotonicNs() + static_cast<int64_t>(timeoutMs) * 1000000;
+        for (;;) {
+            size_t n = tryPopBulk(items, maxCount);
+            if (n > 0) {
+                return n;
+            }
+            if (exit_.load(std::memory_order_acquire)) {
+                return tryPopBulk(items, maxCount);
+            }
+            const int64_t remain = deadline - monotonicNs();
+            if (remain <= 0) {
+                return 0;
+            }
+            struct timespec timeout;
+            timeout.tv_sec = remain / 1000000000;
+            timeout.tv_nsec = remain % 1000000000;
+            waitForData(&timeout);
+        }
+    }
+
+    // 消费者：非阻塞取出一个元素
+    bool tryPop(T& item) {
+        return tryPopBulk(&item, 1) == 1;
+    }
+
+    // 消费者：非阻塞批量取出，返回实际取出的数量
+    size_t tryPopBulk(T* items, size_t maxCount) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        size_t avail = tailCache_ - head;
+        if (avail == 0) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            avail = tailCache_ - head;
+
+            // 记录占用高水位（只有消费者写入）：生产者缓存的 head 可能过旧，在这里用最新的 tail 和本地 head 计算
+            if (avail > highWater_.load(std::memory_order_relaxed)) {
+                highWater_.store(avail, std::memory_order_relaxed);
+            }
+        }
+        const size_t n = maxCount < avail ? maxCount : avail;
+        for (size_t i = 0; i < n; ++i) {
+            items[i] = buffer_[(head + i) & mask_];
+        }
+        if (n > 0) {
+            head_.store(head + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    void setExit(bool exit) {
+        exit_.store(exit, std::memory_order_release);
+        // 唤醒可能正在休眠的消费者
+        futexWord_.fetch_add(1, std::memory_order_release);
+        futexWake();
+    }
+
+    size_t size() const {
+        // 先读 head 再读 tail，保证结果不会因并发推进而下溢
+        const size_t head = head_.load(std::memory_order_acquire);
+        return tail_.load(std::memory_order_acquire) - head;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    bool full() const {
+        return size() >= capacity_;
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    // 运行以来消费者取数时看到的最大占用量
+    size_t highWaterMark() const {
+        return highWater_.load(std::memory_order_relaxed);
+    }
+
+    // 消费者进入 futex 休眠的次数
+    uint64_t sleepCount() const {
+        return sleeps_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static size_t roundUpPow2(size_t v) {
+        size_t p = 1;
+        while (p < v) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    static int64_t monotonicNs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    // timeout 为空时一直休眠到被唤醒，否则最多休眠 timeout（相对时间）
+    void waitForData(const struct timespec* timeout = nullptr) {
+        // 先自旋，适合数据包间隔很短的突发流量
+        for (unsigned i = 0; i < spinCount_; ++i) {
+            if (tail_.load(std::memory_order_acquire) != head_.load(std::memory_order_relaxed) ||
+                exit_.load(std::memory_order_relaxed)) {
+                return;
+            }
+        }
+
+        // 声明即将休眠后必须再检查一次队列，与生产者的屏障配对避免丢失唤醒
+        const uint32_t seq = futexWord_.load(std::memory_order_acquire);
+        sleeping_.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (tail_.load(std::memory_order_relaxed) == head_.load(std::memory_order_relaxed) &&
+            !exit_.load(std::memory_order_relaxed)) {
+            sleeps_.fetch_add(1, std::memory_order_relaxed);
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&futexWord_),
+                    FUTEX_WAIT_PRIVATE, seq, timeout, nullptr, 0);
+        }
+        sleeping_.store(0, std::memory_order_relaxed);
+    }
+
+    void wakeConsumer() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            futexWord_.fetch_add(1, std::memory_order_release);
+            futexWake();
+        }
+    }
+
+    void futexWake() {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&futexWord_),
+                FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    // 只读配置
+    const size_t capacity_;
+    const size_t mask_;
+    std::vector<T> buffer_;
+    const unsigned spinCount_;
+
+    // 消费者独占的缓存行：head、消费者缓存的 tail 和高水位
+    char padConsumer_[GlobalConfig::CacheLineSize];
+    std::atomic<size_t> head_;
+    size_t tailCache_;
+    std::atomic<size_t> highWater_;
+
+    // 生产者独占的缓存行：tail 和生产者缓存的 head
+    char padProducer_[GlobalConfig::CacheLineSize];
+    std::atomic<size_t> tail_;
+    size_t headCache_;
+
+    // 休眠/唤醒状态
+    char padWait_[GlobalConfig::CacheLineSize];
+    std::atomic<int> sleeping_;
+    std::atomic<uint32_t> futexWord_;
+    std::atomic<uint64_t> sleeps_;
+    std::atomic<bool> exit_;
+    char padTail_[GlobalConfig::CacheLineSize];
+};
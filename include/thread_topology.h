@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <sched.h>
+
+// 线程布局：按流水线阶段设置 CPU 亲和性和调度策略，并统计各线程的迁移次数
+// 大小核处理器上把接收和解析固定在大核上，避免解析被调度到小核时出现的延迟尖峰。
+namespace ThreadTopology {
+
+    // 流水线阶段
+    enum Stage {
+        STAGE_RECEIVE,
+        STAGE_PARSE,    // 解析线程，帧的点云构建也在该线程中完成
+        STAGE_WRITER,
+        STAGE_LOGGER,
+        STAGE_COUNT
+    };
+
+    const char* stageName(Stage stage);
+
+    // 解析 CPU 集合："0-3,6"、"big"、"little"、"all"；空字符串返回false（表示不绑定）
+    bool parseCpuList(const std::string& spec, cpu_set_t& set);
+
+    // CPU 集合的可读形式，例如 "4-7"
+    std::string cpuListString(const cpu_set_t& set);
+
+    // 当前线程进入某个阶段：设置线程名、按 ThreadConfig 绑定 CPU 和设置调度策略，
+    // 登记线程用于统计迁移次数，并在日志中输出实际生效的布局
+    void enterStage(Stage stage, const std::string& name);
+
+    // 线程退出前调用，记录最终的迁移次数（线程退出后 /proc 中的记录随之消失）
+    void leaveStage();
+
+    // 按 ThreadConfig::lock_memory 锁定进程内存
+    bool lockMemory();
+
+    // 某阶段所有线程的迁移次数之和（包括已退出的线程）
+    uint64_t stageMigrations(Stage stage);
+
+    // 各线程的布局和迁移次数，用于退出时的日志
+    std::string report();
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "packet_pool.h"
+
+// 批量接收统计信息
+struct RecvBatchStats {
+    uint64_t syscalls;      // recvmmsg 调用次数（包括超时和中断）
+    uint64_t batches;       // 返回了数据的批次数
+    uint64_t packets;       // 接收到的数据报总数
+    uint64_t fullBatches;   // 填满整个批次的次数
+    uint64_t truncated;     // 超出槽位大小被截断的数据报数
+    uint64_t poolExhausted; // 数据包池耗尽、只能接收到丢弃槽位的次数
+    uint64_t softwareTimestamps;  // 没有内核接收时间、以批次返回时间代替的数据报数
+    uint64_t kernelDrops;   // 内核因接收缓冲区满丢弃的数据包累计数（SO_RXQ_OVFL）
+    uint32_t maxFill;       // 单批最大数据报数
+    std::vector<uint64_t> fillHistogram;  // 下标为单批接收到的数据报数
+
+    RecvBatchStats() : syscalls(0), batches(0), packets(0), fullBatches(0),
+                       truncated(0), poolExhausted(0), softwareTimestamps(0), kernelDrops(0), maxFill(0) {}
+
+    // 平均每次有效调用收到的数据报数
+    double averageFill() const {
+        return batches ? static_cast<double>(packets) / batches : 0.0;
+    }
+};
+
+// 为一组绑定在同一端口上的 SO_REUSEPORT 套接字安装分发程序（SO_ATTACH_REUSEPORT_CBPF）：
+// 按来源IP末段对 shardCount 取模选择套接字，套接字序号为绑定顺序。只需对组内任一套接字调用一次。
+// 内核不支持时返回false，内核退回按四元组哈希分发（同一雷达仍固定落在同一个套接字上）。
+bool attachReusePortDispatch(int fd, int shardCount);
+
+// 基于 recvmmsg 的批量 UDP 接收器
+// 一次系统调用将多个数据报直接收进数据包池的槽位，避免逐包 recvfrom 和额外拷贝
+class UdpReceiver {
+public:
+    UdpReceiver(PacketPool& pool, int batchSize);
+
+    UdpReceiver(const UdpReceiver&) = delete;
+    UdpReceiver& operator=(const UdpReceiver&) = delete;
+
+    // 在套接字上开启 SO_TIMESTAMPNS，之后每个数据报带内核接收时间；失败时返回false，仍以批次返回时间代替
+    bool enableTimestamps(int fd);
+
+    // 在套接字上开启 SO_RXQ_OVFL，之后从数据报的控制消息中取内核丢包累计数（stats().kernelDrops）
+    bool enableDropCounter(int fd);
+
+    // 从套接字批量接收，返回本批数据报数量；出错返回 -1 并保留 errno
+    int receiveBatch(int fd);
+
+    // 本批第 i 个数据报所在的槽位；池耗尽时收进丢弃槽位，返回 InvalidPacketHandle
+    PacketHandle packetHandle(int i) const { return handles_[i]; }
+    const uint8_t* packetData(int i) const { return static_cast<const uint8_t*>(iovecs_[i].iov_base); }
+    size_t packetLength(int i) const { return msgs_[i].msg_len; }
+    bool packetTruncated(int i) const { return (msgs_[i].msg_hdr.msg_flags & MSG_TRUNC) != 0; }
+
+    // 接收时间（CLOCK_REALTIME 纳秒）：内核接收时间，取不到时为本批 recvmmsg 返回的时间
+    uint64_t packetRxTimeNs(int i) const { return rxTimes_[i]; }
+
+    // 来源 IPv4 地址（主机字节序）
+    uint32_t sourceAddr(int i) const { return ntohl(addrs_[i].sin_addr.s_addr); }
+
+    // 取走第 i 个槽位的所有权（例如已放入队列），下次接收前会重新申请槽位
+    // 未取走的槽位留在接收器中复用，丢包时无需归还
+    void detach(int i) { handles_[i] = InvalidPacketHandle; }
+
+    // 取走仍挂接在消息头上的槽位。数据包池只能由解析线程归还，
+    // 接收器销毁前调用，由调用者在解析线程退出后归还这些槽位
+    void takeArmedHandles(std::vector<PacketHandle>& out);
+
+    int batchSize() const { return batchSize_; }
+
+    const RecvBatchStats& stats() const { return stats_; }
+
+    // 统计信息的可读描述，用于日志输出
+    std::string statsString() const;
+
+private:
+    void resetHeaders(int count);
+
+    // 为每个消息头挂接控制消息缓冲
+    void attachControls();
+
+    // 从控制消息中取出本批各数据报的内核接收时间和内核丢包累计数
+    void extractControls(int count);
+
+    // 为被取走的位置申请新槽位，返回本次可接收的连续消息头数
+    int armSlots();
+
+    PacketPool& pool_;
+    int batchSize_;
+    std::vector<PacketHandle> handles_;    // 每个消息头当前挂接的槽位
+    std::vector<PacketHandle> spare_;      // 批量申请槽位的临时数组
+    std::vector<struct mmsghdr> msgs_;
+    std::vector<struct iovec> iovecs_;
+    std::vector<struct sockaddr_in> addrs_;
+
+    // 每个消息头的控制消息缓冲，按 cmsghdr 对齐；可同时容纳接收时间和丢包计数
+    union ControlBuffer {
+        struct cmsghdr align;
+        char data[CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t))];
+    };
+    std::vector<ControlBuffer> controls_;
+    std::vector<uint64_t> rxTimes_;        // 本批各数据报的接收时间
+    bool timestamps_;                      // 是否已开启 SO_TIMESTAMPNS
+    bool dropCounter_;                     // 是否已开启 SO_RXQ_OVFL
+    PacketSlot discardSlot_;               // 池耗尽时的丢弃槽位，保证套接字仍被排空
+    int lastCount_;                        // 上一批接收数量，下次接收前需要恢复这些消息头
+    RecvBatchStats stats_;
+};
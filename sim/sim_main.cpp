@@ -0,0 +1,602 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "config.h"
+#include "pktdata.h"
+
+// 亮道 Gen2 雷达模拟器
+// 按 radarDataFrameStructure.md 生成合法的数据包流（每帧 32 个子帧 * 52 个数据包，包头、包序号、
+// GPS 时间戳和合成的场景几何），经 UDP 发往接收程序，用于在开发机上做压力测试。
+// 每个模拟雷达绑定自己的回环源地址（127.0.0.<源地址末段+序号>），接收端按 IP 末段区分雷达。
+// 可按概率注入丢包、重复包和乱序，便于可重复地测量缓冲区大小和丢包行为。
+//
+// 用法: rk3576_LDlidar_sim [选项]
+//   --host ADDR        目的地址（默认 127.0.0.1）
+//   --port N           目的端口（默认 LidarConfig::listenPort）
+//   --lidars N         模拟雷达数（默认 1）
+//   --source-base N    第一个雷达的源地址末段（默认 10，与 LidarConfig 中的雷达一致）
+//   --fps F            每个雷达的帧率（默认 5，即文档中的 92.7 Mb/s）
+//   --speed X          速率倍数，在帧率基础上整体加速（默认 1）
+//   --frames N         每个雷达发送的帧数，0 表示一直发送（默认 0）
+//   --burst N          每个雷达一次 sendmmsg 发送的数据包数（默认 8）
+//   --loss P           丢包概率（%）
+//   --dup P            重复包概率（%）
+//   --reorder P        乱序概率（%），被选中的包推迟到其后 --reorder-depth 个包之后发送
+//   --reorder-depth N  乱序推迟的包数（默认 4）
+//   --seed N           随机数种子（默认 1）
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    constexpr int PacketsPerSubFrame = 52;
+    constexpr int SubFramesPerFrame = 32;
+    constexpr int PacketsPerFrame = PacketsPerSubFrame * SubFramesPerFrame;
+    constexpr int MaxBurst = 64;
+    constexpr int MaxDelayed = 64;
+    constexpr int WireOverheadBytes = 42;   // 以太网+IP+UDP 头，与文档带宽公式一致
+
+    std::atomic<bool> g_running(true);
+
+    void signalHandler(int)
+    {
+        g_running = false;
+    }
+
+    struct Options {
+        std::string host = "127.0.0.1";
+        int port = LidarConfig::listenPort;
+        int lidars = 1;
+        int sourceBase = 10;
+        double fps = 5.0;
+        double speed = 1.0;
+        long frames = 0;
+        int burst = 8;
+        double lossPct = 0.0;
+        double dupPct = 0.0;
+        double reorderPct = 0.0;
+        int reorderDepth = 4;
+        uint32_t seed = 1;
+    };
+
+    // 被推迟发送的乱序包
+    struct DelayedPacket {
+        Gen2Packet packet;
+        int remaining;       // 还要先发送多少个包
+        bool used;
+    };
+
+    // 单个模拟雷达的状态
+    struct SimLidar {
+        int fd;
+        uint32_t frameId;
+        int packetIndex;     // 当前帧内的下一个数据包（0~1663）
+        uint16_t pktCnt;
+        long framesSent;
+        bool done;
+        uint32_t rng;
+        std::vector<Gen2Packet> out;     // 本批要发送的数据包
+        std::vector<DelayedPacket> delayed;
+
+        // 统计
+        uint64_t sent;
+        uint64_t lost;
+        uint64_t duplicated;
+        uint64_t reordered;
+        uint64_t sendErrors;
+    };
+
+    // 线性同余随机数，返回 [0, 100) 的百分比
+    double nextPercent(uint32_t &rng)
+    {
+        rng = rng * 1103515245u + 12345u;
+        return (rng >> 8) * (100.0 / 16777216.0);
+    }
+
+    int16_t toRaw(double meters)
+    {
+        double v = meters * 512.0;
+        if (v > 32767.0)
+        {
+            v = 32767.0;
+        }
+        if (v < -32768.0)
+        {
+            v = -32768.0;
+        }
+        return static_cast<int16_t>(lrint(v));
+    }
+
+    // 构造一帧 1664 个数据包的模板：负载为合成场景，包头中与时间和序号无关的字段已填好
+    // 场景：地面（雷达高 1.5 米）加 12 米处带起伏的墙面，上方为空（无效点）；
+    // 第一回波为最近的表面，部分像素有落在后方 2 米处的第二回波，第三回波为空。
+    void buildFrameTemplate(std::vector<Gen2Packet> &frame)
+    {
+        frame.resize(PacketsPerFrame);
+        memset(frame.data(), 0, frame.size() * sizeof(Gen2Packet));
+
+        const int rows = PacketConfig::LD_LM_LIDAR_HEIGHT;
+        const int cols = PacketConfig::LD_LM_LIDAR_WIDTH;
+        const double hFov = 120.0 * M_PI / 180.0;
+        const double vFov = 25.0 * M_PI / 180.0;
+        const double sensorHeight = 1.5;
+
+        for (int sub = 0; sub < SubFramesPerFrame; ++sub)
+        {
+            for (int p = 0; p < PacketsPerSubFrame; ++p)
+            {
+                Gen2Packet &packet = frame[sub * PacketsPerSubFrame + p];
+                const bool last = (p == PacketsPerSubFrame - 1);
+                const int startCol = last ? 255 : p * PacketConfig::COLS_PER_PACKET;
+
+                packet.head.pktHead = htonl(0x55AA5AA5);
+                packet.head.pktLength = htons(static_cast<uint16_t>(sizeof(Gen2Packet) - 8));
+                packet.head.protocolVersion = htons(1);
+                packet.head.timeSyncType = 0x02;
+                packet.head.timeSyncStatus = 0x02;
+                packet.head.productId = htons(0x02);
+                packet.head.subFrameId = static_cast<uint8_t>(sub);
+                packet.head.startColId = static_cast<uint8_t>(startCol);
+                packet.head.endColId = static_cast<uint8_t>(last ? 255 : startCol + PacketConfig::COLS_PER_PACKET - 1);
+
+                // 负载按 [列][行] 排列：每包 5 列，每列 6 行；最后一包只有第 255 列
+                const int colCount = last ? 1 : PacketConfig::COLS_PER_PACKET;
+                for (int c = 0; c < colCount; ++c)
+                {
+                    const int col = startCol + c;
+                    const double azimuth = (col - (cols - 1) / 2.0) / cols * hFov;
+                    for (int r = 0; r < PacketConfig::ROWS_PER_SUBFRAME; ++r)
+                    {
+                        const int row = sub * PacketConfig::ROWS_PER_SUBFRAME + r;
+                        const double elevation = ((rows - 1) / 2.0 - row) / rows * vFov;
+                        const double dx = cos(elevation) * cos(azimuth);
+                        const double dy = cos(elevation) * sin(azimuth);
+                        const double dz = sin(elevation);
+
+                        // 最近的表面：墙面 x = 12 + 起伏，或地面 z = -sensorHeight
+                        const double wallX = 12.0 + 0.5 * sin(col * 0.1) * cos(row * 0.05);
+                        double range = wallX / dx;
+                        if (dz < 0)
+                        {
+                            const double groundRange = -sensorHeight / dz;
+                            if (groundRange < range)
+                            {
+                                range = groundRange;
+                            }
+                        }
+                        // 墙顶（高 4 米）以上没有回波
+                        const bool hit = range > 0 && range < 60.0 && range * dz < 4.0;
+
+                        Payload &point = packet.payload[c * PacketConfig::ROWS_PER_SUBFRAME + r];
+                        if (!hit)
+                        {
+                            continue;
+                        }
+                        for (int e = 0; e < 2; ++e)
+                        {
+                            // 第二回波只在部分像素出现
+                            if (e == 1 && ((row * 7 + col * 3) % 5) != 0)
+                            {
+                                break;
+                            }
+                            const double d = range + e * 2.0;
+                            point.x[e] = htons(static_cast<uint16_t>(toRaw(d * dx)));
+                            point.y[e] = htons(static_cast<uint16_t>(toRaw(d * dy)));
+                            point.z[e] = htons(static_cast<uint16_t>(toRaw(d * dz)));
+                            point.dist[e] = htons(static_cast<uint16_t>(toRaw(d)));
+                            point.intensity[e] = htonl(static_cast<uint32_t>(20000 / (1.0 + d)));
+                            point.reflectivity[e] = static_cast<uint8_t>(40 + (col + row) % 60);
+                            point.echoLabel[e].BIT.echoChose = (e == 0);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // 用当前实时时钟填写 GPS 时间戳（年份从1900年起）
+    void fillGpsTime(GPSTimeStamp &gps, const struct timespec &now)
+    {
+        struct tm tmNow;
+        gmtime_r(&now.tv_sec, &tmNow);
+        gps.year = static_cast<uint8_t>(tmNow.tm_year);
+        gps.month = static_cast<uint8_t>(tmNow.tm_mon + 1);
+        gps.day = static_cast<uint8_t>(tmNow.tm_mday);
+        gps.hour = static_cast<uint8_t>(tmNow.tm_hour);
+        gps.minute = static_cast<uint8_t>(tmNow.tm_min);
+        gps.second = static_cast<uint8_t>(tmNow.tm_sec);
+        gps.millisecond = htons(static_cast<uint16_t>(now.tv_nsec / 1000000));
+        gps.microsecond = htons(static_cast<uint16_t>((now.tv_nsec / 1000) % 1000));
+    }
+
+    // 把一个包放入发送批次，并释放推迟到期的乱序包
+    void emitPacket(SimLidar &lidar, const Gen2Packet &packet)
+    {
+        lidar.out.push_back(packet);
+        for (auto &d : lidar.delayed)
+        {
+            if (d.used && --d.remaining <= 0)
+            {
+                lidar.out.push_back(d.packet);
+                d.used = false;
+            }
+        }
+    }
+
+    // 生成下一个数据包并按概率注入丢包、重复和乱序
+    void produceNext(SimLidar &lidar, const std::vector<Gen2Packet> &frame, const Options &opt,
+                     const struct timespec &now)
+    {
+        Gen2Packet packet = frame[lidar.packetIndex];
+        packet.head.pktCnt = htons(lidar.pktCnt++);
+        packet.head.frameId = htonl(lidar.frameId);
+        fillGpsTime(packet.head.gpsTime, now);
+
+        if (++lidar.packetIndex == PacketsPerFrame)
+        {
+            lidar.packetIndex = 0;
+            lidar.frameId++;
+            if (++lidar.framesSent >= opt.frames && opt.frames > 0)
+            {
+                lidar.done = true;
+            }
+        }
+
+        if (opt.lossPct > 0 && nextPercent(lidar.rng) < opt.lossPct)
+        {
+            lidar.lost++;
+            return;
+        }
+
+        if (opt.reorderPct > 0 && nextPercent(lidar.rng) < opt.reorderPct)
+        {
+            for (auto &d : lidar.delayed)
+            {
+                if (!d.used)
+                {
+                    d.packet = packet;
+                    d.remaining = opt.reorderDepth;
+                    d.used = true;
+                    lidar.reordered++;
+                    return;
+                }
+            }
+            // 推迟队列已满时正常发送
+        }
+
+        emitPacket(lidar, packet);
+        if (opt.dupPct > 0 && nextPercent(lidar.rng) < opt.dupPct)
+        {
+            lidar.duplicated++;
+            emitPacket(lidar, packet);
+        }
+    }
+
+    // 发送本批数据包，队满（ENOBUFS/EAGAIN）时计数后丢弃
+    void flushBatch(SimLidar &lidar, const struct sockaddr_in &dest)
+    {
+        size_t offset = 0;
+        while (offset < lidar.out.size())
+        {
+            struct mmsghdr msgs[MaxBurst * 2 + MaxDelayed];
+            struct iovec iovs[MaxBurst * 2 + MaxDelayed];
+            const size_t count = lidar.out.size() - offset;
+            for (size_t i = 0; i < count; ++i)
+            {
+                iovs[i].iov_base = &lidar.out[offset + i];
+                iovs[i].iov_len = sizeof(Gen2Packet);
+                memset(&msgs[i], 0, sizeof(msgs[i]));
+                msgs[i].msg_hdr.msg_name = const_cast<struct sockaddr_in *>(&dest);
+                msgs[i].msg_hdr.msg_namelen = sizeof(dest);
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int n = sendmmsg(lidar.fd, msgs, count, 0);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                // 本批剩余的包丢弃
+                lidar.sendErrors += count;
+                break;
+            }
+            lidar.sent += n;
+            offset += n;
+        }
+        lidar.out.clear();
+    }
+
+    bool parseOptions(int argc, char **argv, Options &opt)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "参数缺少取值: %s\n", arg.c_str());
+                return false;
+            }
+            const char *value = argv[++i];
+            if (arg == "--host")
+            {
+                opt.host = value;
+            }
+            else if (arg == "--port")
+            {
+                opt.port = atoi(value);
+            }
+            else if (arg == "--lidars")
+            {
+                opt.lidars = atoi(value);
+            }
+            else if (arg == "--source-base")
+            {
+                opt.sourceBase = atoi(value);
+            }
+            else if (arg == "--fps")
+            {
+                opt.fps = atof(value);
+            }
+            else if (arg == "--speed")
+            {
+                opt.speed = atof(value);
+            }
+            else if (arg == "--frames")
+            {
+                opt.frames = atol(value);
+            }
+            else if (arg == "--burst")
+            {
+                opt.burst = atoi(value);
+            }
+            else if (arg == "--loss")
+            {
+                opt.lossPct = atof(value);
+            }
+            else if (arg == "--dup")
+            {
+                opt.dupPct = atof(value);
+            }
+            else if (arg == "--reorder")
+            {
+                opt.reorderPct = atof(value);
+            }
+            else if (arg == "--reorder-depth")
+            {
+                opt.reorderDepth = atoi(value);
+            }
+            else if (arg == "--seed")
+            {
+                opt.seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            }
+            else
+            {
+                fprintf(stderr, "未知参数: %s\n", arg.c_str());
+                return false;
+            }
+        }
+
+        if (opt.lidars < 1 || opt.sourceBase < 1 || opt.sourceBase + opt.lidars > 255)
+        {
+            fprintf(stderr, "雷达数或源地址末段无效\n");
+            return false;
+        }
+        if (opt.fps <= 0 || opt.speed <= 0)
+        {
+            fprintf(stderr, "帧率和速率倍数必须大于0\n");
+            return false;
+        }
+        if (opt.burst < 1 || opt.burst > MaxBurst)
+        {
+            fprintf(stderr, "--burst 取值范围 1~%d\n", MaxBurst);
+            return false;
+        }
+        if (opt.reorderDepth < 1 || opt.reorderDepth > MaxDelayed)
+        {
+            fprintf(stderr, "--reorder-depth 取值范围 1~%d\n", MaxDelayed);
+            return false;
+        }
+        return true;
+    }
+
+    // 创建绑定到回环源地址的发送套接字；目的地址不是回环时使用系统选择的源地址
+    int openLidarSocket(int lastOctet, bool loopback)
+    {
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0)
+        {
+            fprintf(stderr, "socket() 失败: %s\n", strerror(errno));
+            return -1;
+        }
+
+        int sndbuf = 4 * 1024 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+        if (loopback)
+        {
+            struct sockaddr_in src;
+            memset(&src, 0, sizeof(src));
+            src.sin_family = AF_INET;
+            src.sin_port = 0;
+            src.sin_addr.s_addr = htonl((127u << 24) | static_cast<uint32_t>(lastOctet));
+            if (bind(fd, reinterpret_cast<struct sockaddr *>(&src), sizeof(src)) < 0)
+            {
+                fprintf(stderr, "绑定源地址 127.0.0.%d 失败: %s\n", lastOctet, strerror(errno));
+                close(fd);
+                return -1;
+            }
+        }
+        return fd;
+    }
+
+    // 按文档公式计算的线路速率（Mb/s，含每包 42 字节帧开销）
+    double wireMbps(uint64_t packets, double seconds)
+    {
+        return packets * (sizeof(Gen2Packet) + WireOverheadBytes) * 8.0 / (1024.0 * 1024.0) / seconds;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt))
+    {
+        return 1;
+    }
+
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+
+    struct sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(opt.port);
+    if (inet_pton(AF_INET, opt.host.c_str(), &dest.sin_addr) != 1)
+    {
+        fprintf(stderr, "目的地址无效: %s\n", opt.host.c_str());
+        return 1;
+    }
+    const bool loopback = (ntohl(dest.sin_addr.s_addr) >> 24) == 127;
+
+    std::vector<Gen2Packet> frame;
+    buildFrameTemplate(frame);
+
+    std::vector<SimLidar> lidars(opt.lidars);
+    for (int i = 0; i < opt.lidars; ++i)
+    {
+        SimLidar &lidar = lidars[i];
+        lidar.fd = openLidarSocket(opt.sourceBase + i, loopback);
+        if (lidar.fd < 0)
+        {
+            return 1;
+        }
+        lidar.frameId = 1000 * (i + 1);
+        lidar.packetIndex = 0;
+        lidar.pktCnt = 0;
+        lidar.framesSent = 0;
+        lidar.done = false;
+        lidar.rng = opt.seed * 2654435761u + static_cast<uint32_t>(i);
+        lidar.out.reserve(opt.burst * 2 + MaxDelayed);
+        lidar.delayed.assign(MaxDelayed, DelayedPacket());
+        for (auto &d : lidar.delayed)
+        {
+            d.used = false;
+        }
+        lidar.sent = lidar.lost = lidar.duplicated = lidar.reordered = lidar.sendErrors = 0;
+    }
+
+    // 每个雷达每批 burst 个包，按绝对截止时间发送，睡眠误差不会累积
+    const double packetsPerSecond = PacketsPerFrame * opt.fps * opt.speed;
+    const std::chrono::nanoseconds period(static_cast<int64_t>(opt.burst * 1e9 / packetsPerSecond));
+
+    printf("模拟 %d 个雷达 -> %s:%d, 每雷达 %.1f 帧/s, %.0f 包/s, 线路速率 %.1f Mb/s (合计 %.1f Mb/s)\n",
+           opt.lidars, opt.host.c_str(), opt.port, opt.fps * opt.speed, packetsPerSecond,
+           wireMbps(static_cast<uint64_t>(packetsPerSecond), 1.0),
+           wireMbps(static_cast<uint64_t>(packetsPerSecond), 1.0) * opt.lidars);
+    if (opt.lossPct > 0 || opt.dupPct > 0 || opt.reorderPct > 0)
+    {
+        printf("注入: 丢包 %.3f%%, 重复 %.3f%%, 乱序 %.3f%% (推迟 %d 包)\n",
+               opt.lossPct, opt.dupPct, opt.reorderPct, opt.reorderDepth);
+    }
+
+    const Clock::time_point start = Clock::now();
+    Clock::time_point due = start;
+    Clock::time_point nextReport = start + std::chrono::seconds(1);
+    uint64_t lastSent = 0;
+    bool allDone = false;
+
+    while (g_running && !allDone)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        allDone = true;
+        for (auto &lidar : lidars)
+        {
+            for (int n = 0; n < opt.burst && !lidar.done; ++n)
+            {
+                produceNext(lidar, frame, opt, now);
+            }
+            if (lidar.done)
+            {
+                // 最后一批：推迟中的乱序包也发出去
+                for (auto &d : lidar.delayed)
+                {
+                    if (d.used)
+                    {
+                        lidar.out.push_back(d.packet);
+                        d.used = false;
+                    }
+                }
+            }
+            else
+            {
+                allDone = false;
+            }
+            flushBatch(lidar, dest);
+        }
+
+        due += period;
+        Clock::time_point current = Clock::now();
+        if (due > current)
+        {
+            std::this_thread::sleep_until(due);
+        }
+        else if (current - due > std::chrono::milliseconds(100))
+        {
+            // 明显落后时不再追赶，避免恢复后突发发送
+            due = current;
+        }
+
+        if (current >= nextReport)
+        {
+            uint64_t sent = 0;
+            for (const auto &lidar : lidars)
+            {
+                sent += lidar.sent;
+            }
+            const double seconds = std::chrono::duration<double>(current - nextReport).count() + 1.0;
+            printf("已发送 %llu 包, 最近 %.0f 包/s, %.1f Mb/s\n", static_cast<unsigned long long>(sent),
+                   (sent - lastSent) / seconds, wireMbps(sent - lastSent, seconds));
+            fflush(stdout);
+            lastSent = sent;
+            nextReport = current + std::chrono::seconds(1);
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (size_t i = 0; i < lidars.size(); ++i)
+    {
+        const SimLidar &lidar = lidars[i];
+        printf("雷达 %zu (源地址末段 %d): 发送 %llu 包, 完整发出 %ld 帧, 丢弃 %llu, 重复 %llu, 乱序 %llu, 发送失败 %llu\n",
+               i, opt.sourceBase + static_cast<int>(i), static_cast<unsigned long long>(lidar.sent),
+               lidar.framesSent, static_cast<unsigned long long>(lidar.lost),
+               static_cast<unsigned long long>(lidar.duplicated), static_cast<unsigned long long>(lidar.reordered),
+               static_cast<unsigned long long>(lidar.sendErrors));
+        close(lidar.fd);
+    }
+    uint64_t total = 0;
+    for (const auto &lidar : lidars)
+    {
+        total += lidar.sent;
+    }
+    printf("合计: %.2f s, %llu 包, 平均 %.0f 包/s, %.1f Mb/s\n", seconds,
+           static_cast<unsigned long long>(total), total / seconds, wireMbps(total, seconds));
+    return 0;
+}
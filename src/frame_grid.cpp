@@ -0,0 +1,157 @@
+#include "frame_grid.h"
+#include "config.h"
+#include "logger.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// 覆盖位图常量的类外定义：按引用传递（例如写入日志流）时需要，未优化的 Debug 版本否则链接失败
+const int FrameCoverage::SubFrameCount;
+const int FrameCoverage::PacketsPerSubFrame;
+const int FrameCoverage::SlotCount;
+const int FrameCoverage::WordCount;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LD_COMPACT_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LD_COMPACT_SSE2 1
+#endif
+
+// 紧凑写入时一个点按 16 字节整体存储：x, y, z, 强度(低字节) + 填充
+static_assert(sizeof(Point3D) == 16, "Point3D 布局必须为 16 字节");
+
+namespace {
+    // 将通道长度向上取整到缓存行，保证每个通道都从缓存行边界开始
+    size_t alignToCacheLine(size_t bytes)
+    {
+        return (bytes + GlobalConfig::CacheLineSize - 1) & ~(GlobalConfig::CacheLineSize - 1);
+    }
+}
+
+FrameGrid::FrameGrid(int rows, int cols, int echoes)
+    : rows_(rows), cols_(cols), echoes_(echoes),
+      size_(static_cast<size_t>(rows) * cols * echoes),
+      bytes_(0), memory_(nullptr),
+      x_(nullptr), y_(nullptr), z_(nullptr), intensity_(nullptr), valid_(nullptr),
+      rowValid_(nullptr), validCount_(0)
+{
+    const size_t floatBytes = alignToCacheLine(size_ * sizeof(float));
+    const size_t byteBytes = alignToCacheLine(size_);
+    const size_t rowBytes = alignToCacheLine(rows_ * sizeof(uint32_t));
+    bytes_ = floatBytes * 3 + byteBytes * 2 + rowBytes;
+
+    void *mem = nullptr;
+    if (posix_memalign(&mem, GlobalConfig::CacheLineSize, bytes_) != 0)
+    {
+        LD_FATAL << "帧网格分配失败，字节数: " << bytes_;
+        throw std::bad_alloc();
+    }
+    memory_ = static_cast<uint8_t *>(mem);
+
+    x_ = reinterpret_cast<float *>(memory_);
+    y_ = reinterpret_cast<float *>(memory_ + floatBytes);
+    z_ = reinterpret_cast<float *>(memory_ + floatBytes * 2);
+    intensity_ = memory_ + floatBytes * 3;
+    valid_ = memory_ + floatBytes * 3 + byteBytes;
+    rowValid_ = reinterpret_cast<uint32_t *>(memory_ + floatBytes * 3 + byteBytes * 2);
+
+    // 0.0f 的位模式全为0，可以直接整块清零
+    memset(memory_, 0, bytes_);
+}
+
+FrameGrid::~FrameGrid()
+{
+    free(memory_);
+}
+
+void FrameGrid::clear()
+{
+    // 只有有效点数不为零的行才可能有置位的有效标志
+    const size_t stride = rowStride();
+    for (int row = 0; row < rows_; ++row)
+    {
+        if (rowValid_[row] != 0)
+        {
+            memset(valid_ + row * stride, 0, stride);
+            rowValid_[row] = 0;
+        }
+    }
+    validCount_ = 0;
+}
+
+size_t FrameGrid::validCount(int rowBegin, int rowEnd) const
+{
+    size_t count = 0;
+    for (int row = rowBegin; row < rowEnd; ++row)
+    {
+        count += rowValid_[row];
+    }
+    return count;
+}
+
+size_t FrameGrid::compactRows(int rowBegin, int rowEnd, Point3D *out) const
+{
+    const size_t stride = rowStride();
+    size_t n = 0;
+
+    for (int row = rowBegin; row < rowEnd; ++row)
+    {
+        if (rowValid_[row] == 0)
+        {
+            continue;
+        }
+
+        const size_t begin = row * stride;
+        const size_t end = begin + stride;
+        size_t i = begin;
+
+#if defined(LD_COMPACT_NEON) || defined(LD_COMPACT_SSE2)
+        // 每次取 4 个点：x/y/z/强度 四个通道转置成 4 个 Point3D，
+        // 每个点都写到 out[n]，再按有效标志推进 n，无分支完成紧凑
+        for (; i + 4 <= end; i += 4)
+        {
+            uint32_t packed;
+            memcpy(&packed, intensity_ + i, sizeof(packed));
+#if defined(LD_COMPACT_NEON)
+            const uint32x4_t iw = vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(packed)))));
+            const float32x4x2_t xz = vzipq_f32(vld1q_f32(x_ + i), vld1q_f32(z_ + i));
+            const float32x4x2_t yw = vzipq_f32(vld1q_f32(y_ + i), vreinterpretq_f32_u32(iw));
+            const float32x4x2_t p01 = vzipq_f32(xz.val[0], yw.val[0]);
+            const float32x4x2_t p23 = vzipq_f32(xz.val[1], yw.val[1]);
+            vst1q_f32(reinterpret_cast<float *>(out + n), p01.val[0]);
+            n += valid_[i];
+            vst1q_f32(reinterpret_cast<float *>(out + n), p01.val[1]);
+            n += valid_[i + 1];
+            vst1q_f32(reinterpret_cast<float *>(out + n), p23.val[0]);
+            n += valid_[i + 2];
+            vst1q_f32(reinterpret_cast<float *>(out + n), p23.val[1]);
+            n += valid_[i + 3];
+#else
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i iw = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(packed)), zero), zero);
+            __m128 p0 = _mm_loadu_ps(x_ + i);
+            __m128 p1 = _mm_loadu_ps(y_ + i);
+            __m128 p2 = _mm_loadu_ps(z_ + i);
+            __m128 p3 = _mm_castsi128_ps(iw);
+            _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+            _mm_storeu_ps(reinterpret_cast<float *>(out + n), p0);
+            n += valid_[i];
+            _mm_storeu_ps(reinterpret_cast<float *>(out + n), p1);
+            n += valid_[i + 1];
+            _mm_storeu_ps(reinterpret_cast<float *>(out + n), p2);
+            n += valid_[i + 2];
+            _mm_storeu_ps(reinterpret_cast<float *>(out + n), p3);
+            n += valid_[i + 3];
+#endif
+        }
+#endif
+        for (; i < end; ++i)
+        {
+            out[n] = Point3D(x_[i], y_[i], z_[i], intensity_[i]);
+            n += valid_[i];
+        }
+    }
+    return n;
+}
@@ -1,35 +1,77 @@
 #include "../include/logger.h"
+#include "../include/config.h"
+#include "../include/thread_topology.h"
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <time.h>
 
 // 定义并初始化静态成员变量
 LogLevel Logger::level = INFO;  // 默认日志级别设为 INFO
 LogOutputType Logger::output_type = SYSLOG_OUTPUT;  // 默认输出到系统日志
 
-Logger::~Logger() {
-    // 只有当当前消息级别大于等于设置的级别时才输出
-    if (level_ < Logger::level) {
-        return;
+namespace {
+
+uint64_t clockNowNs(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+const char* levelString(LogLevel level) {
+    switch (level) {
+        case TRACE: return "TRACE";
+        case DEBUG: return "DEBUG";
+        case INFO:  return "INFO ";
+        case WARN:  return "WARN ";
+        case ERROR: return "ERROR";
+        case FATAL: return "FATAL";
+        default:    return "UNKN ";
     }
-    
-    std::stringstream ss;
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    
-    ss << "[" << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S") << "] "
-       << "[" << getLevelString(level_) << "] "
-       << stream_.str();
-       
-    std::string log_message = ss.str();
-    
+}
+
+// 按秒缓存格式化后的本地时间，同一秒内的日志不再调用 localtime_r/strftime
+class TimeCache {
+public:
+    TimeCache() : second_(-1) { text_[0] = '\0'; }
+
+    const char* format(uint64_t timeNs) {
+        time_t second = static_cast<time_t>(timeNs / 1000000000ULL);
+        if (second != second_) {
+            struct tm tmv;
+            localtime_r(&second, &tmv);
+            strftime(text_, sizeof(text_), "%Y-%m-%d %H:%M:%S", &tmv);
+            second_ = second;
+        }
+        return text_;
+    }
+
+private:
+    time_t second_;
+    char text_[32];
+};
+
+// 输出一条日志到控制台和/或系统日志；flush 为false时由调用者批量刷新控制台
+void emit(LogLevel level, const char* time, const char* text, size_t length, bool flush) {
+    std::string log_message;
+    log_message.reserve(length + 40);
+    log_message.append("[").append(time).append("] [").append(levelString(level)).append("] ");
+    log_message.append(text, length);
+
     // 根据输出类型选择输出目标
     if (Logger::output_type == CONSOLE_OUTPUT || Logger::output_type == BOTH_OUTPUT) {
-        std::cout << log_message << std::endl;
+        std::cout << log_message << '\n';
+        if (flush) {
+            std::cout.flush();
+        }
     }
-    
+
     // 如果是严重错误或设置为输出到系统日志，则输出到系统日志
-    if ((level_ >= ERROR || Logger::output_type == SYSLOG_OUTPUT || Logger::output_type == BOTH_OUTPUT)) {
+    if ((level >= ERROR || Logger::output_type == SYSLOG_OUTPUT || Logger::output_type == BOTH_OUTPUT)) {
         // 转换日志级别
         int syslog_level;
-        switch (level_) {
+        switch (level) {
             case TRACE: syslog_level = LOG_DEBUG; break;
             case DEBUG: syslog_level = LOG_DEBUG; break;
             case INFO:  syslog_level = LOG_INFO; break;
@@ -38,20 +80,282 @@ Logger::~Logger() {
             case FATAL: syslog_level = LOG_CRIT; break;
             default:    syslog_level = LOG_NOTICE; break;
         }
-        
+
         // 发送到 syslog
         syslog(syslog_level, "%s", log_message.c_str());
     }
 }
 
-std::string Logger::getLevelString(LogLevel level) {
-    switch (level) {
-        case TRACE: return "TRACE";
-        case DEBUG: return "DEBUG";
-        case INFO:  return "INFO ";
-        case WARN:  return "WARN ";
-        case ERROR: return "ERROR";
-        case FATAL: return "FATAL";
-        default:    return "UNKN ";
+struct LogRecord {
+    uint64_t timeNs;    // 入队时的系统时间（CLOCK_REALTIME_COARSE）
+    LogLevel level;
+    uint16_t length;
+    char text[LogConfig::MaxMessageBytes];
+};
+
+// 有界无锁多生产者队列（每个单元带序号），只有后台输出线程消费
+// 生产者只做一次 CAS 和一次拷贝，队列满时直接返回false，不等待
+class LogQueue {
+public:
+    static const size_t Capacity = LogConfig::QueueCapacity;
+    static_assert((Capacity & (Capacity - 1)) == 0, "LogConfig::QueueCapacity 必须是2的幂");
+
+    LogQueue() : enqueuePos_(0), dequeuePos_(0) {
+        for (size_t i = 0; i < Capacity; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(LogLevel level, uint64_t timeNs, const char* text, size_t length) {
+        Cell* cell;
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & (Capacity - 1)];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // 队列满
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        if (length > sizeof(cell->record.text)) {
+            length = sizeof(cell->record.text);
+        }
+        cell->record.timeNs = timeNs;
+        cell->record.level = level;
+        cell->record.length = static_cast<uint16_t>(length);
+        memcpy(cell->record.text, text, length);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 队首记录，队列为空时返回nullptr；只由消费者调用，用完后调用 pop()
+    const LogRecord* front() {
+        Cell& cell = cells_[dequeuePos_ & (Capacity - 1)];
+        if (cell.seq.load(std::memory_order_acquire) != dequeuePos_ + 1) {
+            return nullptr;
+        }
+        return &cell.record;
+    }
+
+    void pop() {
+        cells_[dequeuePos_ & (Capacity - 1)].seq.store(dequeuePos_ + Capacity, std::memory_order_release);
+        ++dequeuePos_;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        LogRecord record;
+    };
+
+    Cell cells_[Capacity];
+    alignas(GlobalConfig::CacheLineSize) std::atomic<size_t> enqueuePos_;
+    alignas(GlobalConfig::CacheLineSize) size_t dequeuePos_;
+};
+
+// 被限速过的调用点链表（只增不减），后台线程据此定期报告省略的条数
+std::atomic<LogSite*> g_limitedSites(nullptr);
+
+// 报告调用点省略的日志条数
+void reportSuppressed(LogSite& site) {
+    uint32_t n = site.suppressed.exchange(0, std::memory_order_relaxed);
+    if (n == 0) {
+        return;
     }
+    const char* name = strrchr(site.file, '/');
+    std::ostringstream ss;
+    ss << "省略了 " << n << " 条相同位置的日志 (" << (name ? name + 1 : site.file) << ":" << site.line << ")";
+    Logger::write(site.level, ss.str());
+}
+
+// 后台输出线程
+class AsyncSink {
+public:
+    AsyncSink() : running_(false), dropped_(0), reportedDropped_(0) {}
+
+    bool start() {
+        running_.store(true, std::memory_order_release);
+        try {
+            thread_ = std::thread(&AsyncSink::run, this);
+        } catch (const std::exception&) {
+            running_.store(false, std::memory_order_release);
+            return false;
+        }
+        return true;
+    }
+
+    // 停止线程并写完队列；调用后只剩当前线程消费
+    void stop() {
+        running_.store(false, std::memory_order_release);
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    bool push(LogLevel level, const std::string& message) {
+        if (!queue_.push(level, clockNowNs(CLOCK_REALTIME_COARSE), message.data(), message.size())) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    // 写出队列中的全部日志，返回写出的条数
+    size_t drain() {
+        size_t written = 0;
+        while (const LogRecord* record = queue_.front()) {
+            emit(record->level, timeCache_.format(record->timeNs), record->text, record->length, false);
+            queue_.pop();
+            ++written;
+        }
+        if (written > 0) {
+            std::cout.flush();
+        }
+        return written;
+    }
+
+    // 报告被限速调用点省略的条数和队列满丢弃的条数；force 时不等限速窗口结束
+    void reportLosses(bool force) {
+        const uint64_t nowMs = clockNowNs(CLOCK_MONOTONIC_COARSE) / 1000000ULL;
+        for (LogSite* site = g_limitedSites.load(std::memory_order_acquire); site != nullptr;
+             site = site->next.load(std::memory_order_relaxed)) {
+            if (force || nowMs - site->windowStartMs.load(std::memory_order_relaxed) >=
+                             static_cast<uint64_t>(LogConfig::RateWindowMs)) {
+                reportSuppressed(*site);
+            }
+        }
+
+        uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reportedDropped_) {
+            std::ostringstream ss;
+            ss << "日志队列已满，丢弃了 " << dropped - reportedDropped_ << " 条日志";
+            reportedDropped_ = dropped;
+            push(WARN, ss.str());
+        }
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void run() {
+        ThreadTopology::enterStage(ThreadTopology::STAGE_LOGGER, "ld_logger");
+        uint64_t lastReportMs = 0;
+        while (running_.load(std::memory_order_acquire)) {
+            if (drain() == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(LogConfig::FlushIntervalMs));
+            }
+
+            const uint64_t nowMs = clockNowNs(CLOCK_MONOTONIC_COARSE) / 1000000ULL;
+            if (nowMs - lastReportMs >= static_cast<uint64_t>(LogConfig::RateWindowMs)) {
+                reportLosses(false);
+                lastReportMs = nowMs;
+            }
+        }
+        drain();
+        ThreadTopology::leaveStage();
+    }
+
+    LogQueue queue_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> dropped_;
+    uint64_t reportedDropped_;  // 只由消费者访问
+    TimeCache timeCache_;       // 只由消费者访问
+};
+
+// 当前的后台输出线程，为空时同步输出；对象分配后不再释放，避免与仍在入队的线程竞争
+AsyncSink* g_sinkStorage = nullptr;
+std::atomic<AsyncSink*> g_sink(nullptr);
+
+}  // namespace
+
+bool LogSite::allow() {
+    const uint64_t nowMs = clockNowNs(CLOCK_MONOTONIC_COARSE) / 1000000ULL;
+
+    // 进入新窗口时重新计数，并报告上一个窗口省略的条数
+    uint64_t start = windowStartMs.load(std::memory_order_relaxed);
+    if (nowMs - start >= static_cast<uint64_t>(LogConfig::RateWindowMs) &&
+        windowStartMs.compare_exchange_strong(start, nowMs, std::memory_order_relaxed)) {
+        count.store(0, std::memory_order_relaxed);
+        reportSuppressed(*this);
+    }
+
+    if (count.fetch_add(1, std::memory_order_relaxed) < static_cast<uint32_t>(LogConfig::RateBurst)) {
+        return true;
+    }
+
+    // 超出限速：只计数，首次被限速时登记到链表
+    suppressed.fetch_add(1, std::memory_order_relaxed);
+    if (!listed.exchange(true, std::memory_order_relaxed)) {
+        LogSite* head = g_limitedSites.load(std::memory_order_relaxed);
+        do {
+            next.store(head, std::memory_order_relaxed);
+        } while (!g_limitedSites.compare_exchange_weak(head, this, std::memory_order_release,
+                                                       std::memory_order_relaxed));
+    }
+    return false;
+}
+
+Logger::~Logger() {
+    // 只有当当前消息级别大于等于设置的级别时才输出
+    if (level_ < Logger::level) {
+        return;
+    }
+    write(level_, stream_.str());
+}
+
+void Logger::write(LogLevel level, const std::string& message) {
+    AsyncSink* sink = g_sink.load(std::memory_order_acquire);
+    if (sink != nullptr) {
+        sink->push(level, message);
+        return;
+    }
+
+    TimeCache timeCache;
+    emit(level, timeCache.format(clockNowNs(CLOCK_REALTIME)), message.data(), message.size(), true);
+}
+
+bool Logger::startAsync() {
+    if (g_sink.load(std::memory_order_acquire) != nullptr) {
+        return true;
+    }
+    if (g_sinkStorage == nullptr) {
+        // LogQueue 的成员按缓存行对齐，C++11 的 new 不保证超出 max_align_t 的对齐，按缓存行分配后原位构造
+        void* mem = nullptr;
+        if (posix_memalign(&mem, GlobalConfig::CacheLineSize, sizeof(AsyncSink)) != 0) {
+            return false;
+        }
+        g_sinkStorage = new (mem) AsyncSink();
+        // 进程退出时写完队列中的日志
+        atexit([] { Logger::stopAsync(); });
+    }
+    if (!g_sinkStorage->start()) {
+        return false;
+    }
+    g_sink.store(g_sinkStorage, std::memory_order_release);
+    return true;
+}
+
+void Logger::stopAsync() {
+    AsyncSink* sink = g_sink.load(std::memory_order_acquire);
+    if (sink == nullptr) {
+        return;
+    }
+    sink->stop();
+    sink->reportLosses(true);
+    g_sink.store(nullptr, std::memory_order_release);
+
+    // 线程已停止，由当前线程写完剩余的日志
+    sink->drain();
+}
+
+uint64_t Logger::droppedMessages() {
+    return g_sinkStorage ? g_sinkStorage->dropped() : 0;
 }
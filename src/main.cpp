@@ -10,31 +10,60 @@
 #include <thread>
 #include <chrono>
 #include <map>
+#include <memory>
 #include <vector>
 #include <atomic>
 #include <sys/stat.h>
 #include <iomanip>
 #include <sstream>
 #include <cstring>
+#include <mutex>
+#include <algorithm>
 
 #include "config.h"
 #include "logger.h"
 #include "lidar_types.h"
-#include "ring_buffer.h"
+#include "spsc_ring_buffer.h"
 #include "packet_parser.h"
 #include "point_cloud.h"
 #include "pktdata.h"
+#include "packet_pool.h"
+#include "payload_decoder.h"
+#include "udp_receiver.h"
+#include "packet_recorder.h"
+#include "packet_ring.h"
+#include "replay_source.h"
+#include "metrics.h"
+#include "thread_topology.h"
+
+// 接收分片：独立的接收套接字、接收线程、数据包池、队列和解析线程
+// 多个分片时用 SO_REUSEPORT 在同一端口上开多个套接字，雷达按来源IP末段对分片数取模分配到分片，
+// 每个雷达的数据包只由一个分片接收和解析，吞吐随分片数（核数）扩展；分片数为1时即原来的单套接字结构
+struct ReceiveShard {
+    int index;
+    int fd;
+    PacketPool pool;                                // 接收线程申请、解析线程归还
+    SpscRingBuffer<PacketHandle> buffer;            // 接收线程到解析线程的数据包队列
+    std::map<uint32_t, PacketParser *> parsers;     // 本分片负责的雷达，只由本分片的解析线程访问
+    std::atomic<uint64_t> foreignPackets;           // 属于其他分片而被忽略的数据报（组播会投递到每个套接字）
+    std::vector<PacketHandle> armedHandles;         // 接收结束时接收器中未用的槽位，解析线程退出后再归还
+    std::thread procThread;
+
+    explicit ReceiveShard(int idx) :
+        index(idx), fd(-1), pool(GlobalConfig::PacketPoolSize),
+        buffer(GlobalConfig::PacketBufferCapacity, GlobalConfig::PacketBufferSpinCount), foreignPackets(0) {}
+};
 
 // 全局变量
 std::atomic<bool> g_running(true);
-RingBuffer<std::vector<uint8_t>> g_packet_buffer(5000);
-std::map<uint32_t, PacketParser *> g_parsers;
+std::vector<std::unique_ptr<ReceiveShard>> g_shards;
 PointCloudProcessor g_processor;
-int g_socket_fd = -1;
 
 // 监控计数器
-std::atomic<uint64_t> g_dropped_packets(0);
+std::atomic<uint64_t> g_dropped_packets(0);         // 用户态丢弃（截断、池耗尽、队列满）
+std::atomic<uint64_t> g_kernel_dropped_packets(0);  // 内核丢弃（接收缓冲区或抓包环形缓冲已满）
 std::atomic<uint64_t> g_received_packets(0);
+std::atomic<uint64_t> g_completed_frames(0);
 std::map<uint32_t, std::chrono::steady_clock::time_point> g_last_frame_times;
 
 // 信号处理函数
@@ -44,32 +73,70 @@ void signalHandler(int signum)
     g_running = false;
 
     // 关闭套接字以中断recvfrom()阻塞
-    if (g_socket_fd >= 0)
+    for (size_t i = 0; i < g_shards.size(); ++i)
+    {
+        int fd = g_shards[i]->fd;
+        if (fd >= 0)
+        {
+            g_shards[i]->fd = -1;
+            close(fd);
+        }
+    }
+}
+
+// 雷达所属的分片：来源IP末段对分片数取模，与内核中的 SO_REUSEPORT 分发程序一致
+size_t shardOf(uint32_t ipaddr)
+{
+    return ipaddr % g_shards.size();
+}
+
+// 解析器帧完成回调：完成的帧交给点云处理器
+void onFrameComplete(const PointCloudLease &cloud)
+{
+    g_completed_frames++;
+
+    // 帧时间线：接收跨度、末包接收到构建完成、构建完成到回调
+    const FrameTiming &timing = cloud->timing;
+    if (timing.rx_first_ns != 0)
     {
-        close(g_socket_fd);
-        g_socket_fd = -1;
+        LD_DEBUG << "帧(" << cloud->frame_id << ")时间线: 接收跨度="
+                 << (timing.rx_last_ns - timing.rx_first_ns) / 1e6 << "ms, 末包到构建完成="
+                 << (static_cast<int64_t>(timing.parse_done_ns - timing.rx_last_ns)) / 1e6 << "ms, 构建到回调="
+                 << (static_cast<int64_t>(timing.callback_ns - timing.parse_done_ns)) / 1e6 << "ms";
     }
+
+    g_processor.processCloud(cloud);
+}
+
+// 解析器子帧切片回调：流式模式下每个子帧收齐后交给点云处理器
+void onSliceComplete(const PointCloudSlice &slice)
+{
+    g_processor.processSlice(slice);
 }
 
-// 处理线程函数
-void processThread()
+// 处理线程函数：解析一个分片收到的数据包
+void processThread(ReceiveShard &shard)
 {
-    LD_INFO << "点云处理线程启动";
+    ThreadTopology::enterStage(ThreadTopology::STAGE_PARSE, "ld_parse" + std::to_string(shard.index));
+    LD_INFO << "点云处理线程启动（分片 " << shard.index << "）";
 
-    std::vector<uint8_t> packet_data;
+    PacketHandle handles[GlobalConfig::RecvBatchSize];
     while (g_running)
     {
-        if (g_packet_buffer.pop(packet_data))
+        // 限时等待，接收空闲时也能按时检查超时帧
+        size_t count = shard.buffer.popBulkFor(handles, GlobalConfig::RecvBatchSize,
+                                                  FrameConfig::FlushCheckIntervalMs);
+        const uint64_t dequeueNs = monotonicNowNs();
+        uint64_t parseStartNs = dequeueNs;
+        for (size_t n = 0; n < count; ++n)
         {
-            // 提取发送者IP地址 (假设前4字节包含IP信息)
-            uint32_t ipaddr = 0;
-            if (packet_data.size() >= 4)
-            {
-                ipaddr = packet_data[0];
-            }
+            // 直接在槽位中读取数据
+            const PacketSlot &slot = shard.pool.slot(handles[n]);
+            uint32_t ipaddr = slot.ipaddr;
+            Metrics::queueWait.observe(dequeueNs - slot.enqueueTimeNs);
 
             // 创建或获取对应的解析器用于多雷达测试
-            if (g_parsers.find(ipaddr) == g_parsers.end())
+            if (shard.parsers.find(ipaddr) == shard.parsers.end())
             {
                 LD_INFO << "新检测到雷达，IP后缀: " << ipaddr;
 
@@ -95,27 +162,46 @@ void processThread()
                     param.name = "lidar_" + std::to_string(ipaddr);
                 }
 
-                g_parsers[ipaddr] = new PacketParser();
-                g_parsers[ipaddr]->setLidarParam(param);
+                shard.parsers[ipaddr] = new PacketParser();
+                shard.parsers[ipaddr]->setLidarParam(param);
+                shard.parsers[ipaddr]->setFrameCallback(onFrameComplete);
+                if (FrameConfig::StreamSlices)
+                {
+                    shard.parsers[ipaddr]->setSliceCallback(onSliceComplete);
+                }
 
                 LD_INFO << "初始化雷达参数: " << param.toString();
             }
 
             //TODO 在这里可以检查每一个点云处理的时间，如果太长可以考虑写一个自动扩增buffer的机制
 
-            // 解析数据包
-            PointCloud cloud;
-            if (g_parsers[ipaddr]->parsePacket(packet_data.data() + 4,
-                                               packet_data.size() - 4,
-                                               cloud))
+            // 解析数据包，完成的帧通过回调交给点云处理器
+            shard.parsers[ipaddr]->parsePacket(slot.payload, slot.length, slot.rxTimeNs);
+            if (slot.ringRefs != nullptr)
             {
-                // 处理点云
-                g_processor.processCloud(cloud);
+                // 负载在抓包环形缓冲中，读完后接收线程才能把所在块归还内核
+                slot.ringRefs->fetch_sub(1, std::memory_order_release);
             }
+
+            // 相邻两次计时首尾相接，每个数据包只读一次时钟
+            const uint64_t parseEndNs = monotonicNowNs();
+            Metrics::parsePacket.observe(parseEndNs - parseStartNs);
+            parseStartNs = parseEndNs;
+        }
+
+        // 整批处理完后一次性归还槽位
+        shard.pool.releaseBulk(handles, count);
+
+        // 输出超过截止时间仍未完整的帧，限定下游延迟的上界
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (auto &pair : shard.parsers)
+        {
+            pair.second->flushExpired(now);
         }
     }
 
-    LD_INFO << "点云处理线程退出";
+    LD_INFO << "点云处理线程退出（分片 " << shard.index << "）";
+    ThreadTopology::leaveStage();
 }
 
 // 点云回调函数，展示点云信息并可选保存
@@ -124,49 +210,71 @@ void cloudCallback(const PointCloud &cloud)
 
 }
 
-int main(int argc, char **argv)
+// 子帧切片回调函数，障碍物检测等低延迟处理可以在这里按切片开始
+void sliceCallback(const PointCloudSlice &slice)
 {
-    LD_INFO << "RK3576 激光雷达点云处理工具 v" << GlobalConfig::Version;
-
-    // 在程序开始时创建保存目录
-    PointCloudProcessor::ensureDirectoryExists(CloudConfig::save_path);
-
-    // 设置信号处理
-    signal(SIGINT, signalHandler);
+    (void)slice;
+}
 
-    signal(SIGTERM, signalHandler);
+// 按雷达数和帧率估算每个套接字的接收缓冲区：容纳 RecvBufferHoldMs 内到达的数据
+// 多个分片时每个套接字只接收一部分雷达
+int receiveBufferBytes(int lidarCount, int shardCount)
+{
+    const int lidarsPerSocket = (lidarCount + shardCount - 1) / shardCount;
+    const uint64_t bytesPerSecond = static_cast<uint64_t>(lidarsPerSocket) * LidarConfig::FrameRate *
+                                    FrameCoverage::SlotCount * PacketConfig::BIG_PACKET_SIZE;
+    const uint64_t bytes = bytesPerSecond * GlobalConfig::RecvBufferHoldMs / 1000;
+    return static_cast<int>(std::min<uint64_t>(bytes, GlobalConfig::MaxRecvBufferBytes));
+}
 
-    // 解析命令行参数 (端口等)
-    int port = LidarConfig::listenPort;
-    if (argc > 1)
+// 设置接收缓冲区：优先 SO_RCVBUFFORCE（需要 CAP_NET_ADMIN，不受 net.core.rmem_max 限制），否则退回 SO_RCVBUF
+void setReceiveBuffer(int fd, int bytes)
+{
+    bool forced = setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) == 0;
+    if (!forced && setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)) < 0)
     {
-        port = atoi(argv[1]);
+        LD_ERROR << "setsockopt(SO_RCVBUF) 失败: " << strerror(errno);
+        return;
     }
-    LD_INFO << "监听端口: " << port;
-
-    // 设置点云回调
-    g_processor.setCallback(cloudCallback);
 
-    // 启动处理线程
-    std::thread proc_thread(processThread);
+    // 内核把设置值加倍以计入 sk_buff 的开销，读回的是加倍后的值
+    int actual = 0;
+    socklen_t len = sizeof(actual);
+    getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &actual, &len);
+    if (actual < bytes * 2)
+    {
+        LD_WARN << "接收缓冲区只有 " << actual / 1024 << " KiB（请求 " << bytes / 1024
+                << " KiB），受 net.core.rmem_max 限制；以 root 运行或调大 rmem_max";
+    }
+    else
+    {
+        LD_INFO << "接收缓冲区: " << actual / 1024 << " KiB" << (forced ? " (SO_RCVBUFFORCE)" : "");
+    }
+}
 
+// 创建并绑定接收套接字；reusePort 为 true 时多个分片的套接字共享同一端口
+int openSocket(int port, bool reusePort, int bufferBytes)
+{
     // 创建UDP套接字
     int fd = socket(AF_INET, SOCK_DGRAM, 0);
     if (fd < 0)
     {
         LD_FATAL << "socket() 失败: " << strerror(errno);
-        return 1;
+        return -1;
     }
 
-    // 保存到全局变量，以便信号处理函数使用
-    g_socket_fd = fd;
-
     // 设置套接字选项
     int reuse = 1;
     if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0)
     {
         LD_ERROR << "setsockopt(SO_REUSEADDR) 失败: " << strerror(errno);
     }
+    if (reusePort && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0)
+    {
+        LD_FATAL << "setsockopt(SO_REUSEPORT) 失败: " << strerror(errno);
+        close(fd);
+        return -1;
+    }
 
     // 设置套接字超时，防止recvfrom无限阻塞
     struct timeval tv;
@@ -177,6 +285,9 @@ int main(int argc, char **argv)
         LD_ERROR << "setsockopt(SO_RCVTIMEO) 失败: " << strerror(errno);
     }
 
+    // 默认的接收缓冲区只能容纳几毫秒的数据，处理线程稍有停顿就会在内核中丢包
+    setReceiveBuffer(fd, bufferBytes);
+
     // 绑定套接字
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
@@ -188,7 +299,7 @@ int main(int argc, char **argv)
     {
         LD_FATAL << "bind() 失败: " << strerror(errno);
         close(fd);
-        return 1;
+        return -1;
     }
 
     // 如果配置了组播地址，则加入组播
@@ -210,20 +321,49 @@ int main(int argc, char **argv)
         }
     }
 
-    // 接收数据包
-    uint8_t udp_buffer[GlobalConfig::BufferSize];
-    struct sockaddr_in client;
-    socklen_t client_len = sizeof(client);
+    return fd;
+}
+
+// 一个分片的接收循环：批量接收数据包放入本分片的队列，直到收到退出信号
+// filterForeign 为 true 时忽略不属于本分片的雷达（组播数据报会投递到每个套接字）；
+// 多个分片共用录制器时由 recorderMutex 串行化
+void receiveLoop(ReceiveShard &shard, PacketRecorder *recorder, std::mutex *recorderMutex, bool filterForeign)
+{
+    ThreadTopology::enterStage(ThreadTopology::STAGE_RECEIVE, "ld_recv" + std::to_string(shard.index));
+
+    // 批量接收数据包
+    UdpReceiver receiver(shard.pool, GlobalConfig::RecvBatchSize);
+
+    // 每个数据报带内核接收时间，随数据包带入帧，用于端到端延迟统计
+    if (GlobalConfig::KernelRxTimestamps && !receiver.enableTimestamps(shard.fd))
+    {
+        LD_WARN << "setsockopt(SO_TIMESTAMPNS) 失败: " << strerror(errno) << "，以批次接收时间代替";
+    }
+
+    // 内核因接收缓冲区满丢弃的数据包随数据报的控制消息带回，与用户态的丢包分开统计
+    if (GlobalConfig::KernelDropCounter && !receiver.enableDropCounter(shard.fd))
+    {
+        LD_WARN << "setsockopt(SO_RXQ_OVFL) 失败: " << strerror(errno) << "，不统计内核丢包";
+    }
+    uint64_t reportedKernelDrops = 0;
 
-    LD_INFO << "开始接收数据...";
+    LD_INFO << "开始接收数据... (分片 " << shard.index << ", recvmmsg 批大小: " << receiver.batchSize() << ")";
 
     while (g_running)
     {
-        // 接收一个UDP数据包
-        int recvlen = recvfrom(fd, udp_buffer, sizeof(udp_buffer), 0,
-                               (struct sockaddr *)&client, &client_len);
+        int fd = shard.fd;
+        if (fd < 0)
+        {
+            break;
+        }
 
-        if (recvlen < 0)
+        // 一次系统调用接收多个UDP数据包
+        int count = receiver.receiveBatch(fd);
+
+        // 整批数据报使用同一个接收时间，用于统计入队和排队耗时
+        const uint64_t batchNs = monotonicNowNs();
+
+        if (count < 0)
         {
             if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
             {
@@ -235,62 +375,786 @@ int main(int argc, char **argv)
                 // 程序已经设置为退出状态
                 break;
             }
-            LD_ERROR << "recvfrom() 失败: " << strerror(errno);
+            LD_ERROR << "recvmmsg() 失败: " << strerror(errno);
+            g_running = false;
             break;
         }
 
-        // 计数接收的包
-        g_received_packets++;
+        PacketHandle pending[GlobalConfig::RecvBatchSize];
+        int pendingIndex[GlobalConfig::RecvBatchSize];
+        size_t pendingCount = 0;
+
+        for (int i = 0; i < count; ++i)
+        {
+            // 其他分片负责的雷达，不计入本分片的接收
+            if (filterForeign && shardOf(receiver.sourceAddr(i) & 0xFF) != static_cast<size_t>(shard.index))
+            {
+                shard.foreignPackets.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            // 计数接收的包
+            g_received_packets++;
+
+            // 超出槽位的数据报已被截断，不能交给解析器
+            if (receiver.packetTruncated(i))
+            {
+                g_dropped_packets++;
+                LD_WARN << "数据包超出接收槽位大小被截断，丢弃";
+                continue;
+            }
+
+            // 录制原始数据报（包括因数据包池耗尽而无法解析的）
+            if (recorder)
+            {
+                if (recorderMutex)
+                {
+                    std::lock_guard<std::mutex> lock(*recorderMutex);
+                    recorder->record(receiver.packetData(i), receiver.packetLength(i), receiver.sourceAddr(i),
+                                     receiver.packetRxTimeNs(i));
+                }
+                else
+                {
+                    recorder->record(receiver.packetData(i), receiver.packetLength(i), receiver.sourceAddr(i),
+                                     receiver.packetRxTimeNs(i));
+                }
+            }
+
+            PacketHandle handle = receiver.packetHandle(i);
+            if (handle == InvalidPacketHandle)
+            {
+                // 数据包池耗尽，数据已收进丢弃槽位
+                g_dropped_packets++;
+                LD_WARN << "数据包池已耗尽，丢弃数据包";
+                continue;
+            }
+
+            // 数据已由内核直接写入槽位，这里只补充长度和来源
+            PacketSlot &slot = shard.pool.slot(handle);
+            slot.length = static_cast<uint16_t>(receiver.packetLength(i));
+            // 提取IP地址的最后一个字节(IPv4地址最后一段)
+            slot.ipaddr = receiver.sourceAddr(i) & 0xFF; // 只取最后一位
+            slot.enqueueTimeNs = batchNs;
+            slot.rxTimeNs = receiver.packetRxTimeNs(i);
+
+            pending[pendingCount] = handle;
+            pendingIndex[pendingCount] = i;
+            pendingCount++;
+        }
+
+        // 整批句柄一次放入缓冲区，成功放入的槽位归处理线程所有
+        size_t pushed = shard.buffer.pushBulk(pending, pendingCount);
+        for (size_t n = 0; n < pushed; ++n)
+        {
+            receiver.detach(pendingIndex[n]);
+        }
+        if (pendingCount > 0)
+        {
+            Metrics::recvToEnqueue.observe(monotonicNowNs() - batchNs);
+        }
+        if (pushed < pendingCount)
+        {
+            // 未放入的槽位留在接收器中复用
+            g_dropped_packets += pendingCount - pushed;
+            LD_WARN << "缓冲区已满，丢弃 " << (pendingCount - pushed) << " 个数据包";
+        }
+
+        if (receiver.stats().kernelDrops > reportedKernelDrops)
+        {
+            const uint64_t drops = receiver.stats().kernelDrops - reportedKernelDrops;
+            reportedKernelDrops = receiver.stats().kernelDrops;
+            g_kernel_dropped_packets += drops;
+            LD_WARN << "接收缓冲区溢出，内核丢弃了 " << drops << " 个数据包（分片 " << shard.index << "）";
+        }
+
+        // 定期输出批量接收统计，用于在实际负载下调节批大小
+        if (count > 0 && receiver.stats().batches % GlobalConfig::RecvStatsInterval == 0)
+        {
+            LD_DEBUG << "批量接收统计(分片 " << shard.index << "): " << receiver.statsString()
+                     << ", 队列占用高水位: " << shard.buffer.highWaterMark();
+        }
+    }
+
+    LD_INFO << "批量接收统计(分片 " << shard.index << "): " << receiver.statsString();
+    receiver.takeArmedHandles(shard.armedHandles);
+    ThreadTopology::leaveStage();
+}
+
+// 可选的原始数据包录制，在接收线程旁把数据报追加到映射的分段文件；未开启或启动失败时返回空
+std::unique_ptr<PacketRecorder> startRecorder()
+{
+    std::unique_ptr<PacketRecorder> recorder;
+    if (RecordConfig::enabled)
+    {
+        recorder.reset(new PacketRecorder(RecordConfig::path, RecordConfig::SegmentBytes, RecordConfig::SegmentSeconds,
+                                          RecordConfig::BlackBoxSeconds, RecordConfig::FrameIndexCapacity));
+        if (!recorder->start())
+        {
+            LD_ERROR << "原始数据包录制启动失败，继续运行但不录制";
+            recorder.reset();
+        }
+    }
+    return recorder;
+}
 
-        // 提取IP地址的最后一个字节(IPv4地址最后一段)
-        uint32_t ipaddr = ntohl(client.sin_addr.s_addr) & 0xFF; // 只取最后一位
+// 实时接收：每个分片一个套接字和接收线程，直到收到退出信号
+int receivePackets(int port, int lidarCount)
+{
+    const int shardCount = static_cast<int>(g_shards.size());
+    const int bufferBytes = receiveBufferBytes(lidarCount, shardCount);
+    LD_INFO << "接收缓冲区按 " << lidarCount << " 台雷达 × " << LidarConfig::FrameRate << " Hz 估算，每个套接字请求 "
+            << bufferBytes / 1024 << " KiB";
 
-        // 构建包含IP和数据的缓冲区
-        std::vector<uint8_t> packet_data(recvlen + 4);
-        // 在第一个字节保存IP地址的最后一段，其余三个字节保留为0
-        packet_data[0] = (uint8_t)ipaddr;
-        packet_data[1] = 0;
-        packet_data[2] = 0;
-        packet_data[3] = 0;
-        // 复制数据包内容
-        memcpy(packet_data.data() + 4, udp_buffer, recvlen);
+    // 先按分片顺序绑定所有套接字，SO_REUSEPORT 组内的套接字序号即绑定顺序
+    for (int i = 0; i < shardCount; ++i)
+    {
+        int fd = openSocket(port, shardCount > 1, bufferBytes);
+        if (fd < 0)
+        {
+            for (int j = 0; j < i; ++j)
+            {
+                close(g_shards[j]->fd);
+                g_shards[j]->fd = -1;
+            }
+            return 1;
+        }
+        g_shards[i]->fd = fd;
+    }
 
-        // 将数据包放入缓冲区
-        if (!g_packet_buffer.push(packet_data))
+    // 多个分片：内核按来源IP把每个雷达固定分到一个套接字
+    // 装不上分发程序时退回内核的四元组哈希，单播时同一雷达仍只落在一个套接字上，但可能多个雷达挤在同一分片
+    bool filterForeign = false;
+    if (shardCount > 1)
+    {
+        if (attachReusePortDispatch(g_shards[0]->fd, shardCount))
+        {
+            filterForeign = true;
+            LD_INFO << "接收分片: " << shardCount << "，按来源IP末段对 " << shardCount << " 取模分配";
+        }
+        else
         {
-            g_dropped_packets++; // 计数丢弃的包
-            LD_WARN << "缓冲区已满，丢弃数据包";
+            LD_WARN << "SO_ATTACH_REUSEPORT_CBPF 失败: " << strerror(errno)
+                    << "，接收分片按内核哈希分配，组播数据会被每个分片重复接收";
         }
     }
 
+    std::unique_ptr<PacketRecorder> recorder = startRecorder();
+    std::mutex recorderMutex;
+    std::mutex *sharedRecorderMutex = shardCount > 1 ? &recorderMutex : nullptr;
+
+    // 分片 0 在当前线程接收，其余分片各开一个接收线程
+    std::vector<std::thread> threads;
+    for (int i = 1; i < shardCount; ++i)
+    {
+        threads.push_back(std::thread(receiveLoop, std::ref(*g_shards[i]), recorder.get(), sharedRecorderMutex,
+                                      filterForeign));
+    }
+    receiveLoop(*g_shards[0], recorder.get(), sharedRecorderMutex, filterForeign);
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        threads[i].join();
+    }
+
     // 清理资源
-    if (g_socket_fd >= 0)
+    for (int i = 0; i < shardCount; ++i)
+    {
+        int fd = g_shards[i]->fd;
+        if (fd >= 0)
+        {
+            g_shards[i]->fd = -1;
+            close(fd);
+        }
+    }
+
+    // 接收已停止，收尾录制分段
+    if (recorder)
     {
-        close(g_socket_fd);
-        g_socket_fd = -1;
+        recorder->stop();
     }
 
-    // 确保缓冲区不再阻塞处理线程
-    g_packet_buffer.setExit(true);
+    return 0;
+}
 
-    // 等待处理线程结束
-    if (proc_thread.joinable())
+// 把一批句柄全部放入分片的缓冲区；回放时队满就等待处理线程，而不是像实时接收那样丢包
+void pushAllHandles(ReceiveShard &shard, const PacketHandle *handles, size_t count)
+{
+    size_t pushed = 0;
+    while (pushed < count && g_running)
+    {
+        pushed += shard.buffer.pushBulk(handles + pushed, count - pushed);
+        if (pushed < count)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    // 退出时未放入的数据包不再处理
+    g_dropped_packets += count - pushed;
+}
+
+// 回放和抓包时每个分片攒一批再放入队列
+struct ShardBatch {
+    PacketHandle handles[GlobalConfig::RecvBatchSize];
+    size_t count;
+
+    ShardBatch() : count(0) {}
+};
+
+// 交出所有分片中攒着的数据包
+void pushAllBatches(std::vector<ShardBatch> &batches)
+{
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+        pushAllHandles(*g_shards[i], batches[i].handles, batches[i].count);
+        batches[i].count = 0;
+    }
+}
+
+// 抓包时交出一个分片攒着的数据包；队列满时像实时接收一样丢弃，未放入的槽位留待复用
+// （数据包池只能由处理线程归还），并释放它们对环形缓冲块的引用
+void pushCapturedBatch(ReceiveShard &shard, ShardBatch &batch, std::vector<PacketHandle> &reuse)
+{
+    size_t pushed = shard.buffer.pushBulk(batch.handles, batch.count);
+    if (pushed < batch.count)
     {
-        LD_INFO << "等待点云处理线程退出...";
-        proc_thread.join();
+        for (size_t n = pushed; n < batch.count; ++n)
+        {
+            shard.pool.slot(batch.handles[n]).ringRefs->fetch_sub(1, std::memory_order_release);
+            reuse.push_back(batch.handles[n]);
+        }
+        g_dropped_packets += batch.count - pushed;
+        LD_WARN << "缓冲区已满，丢弃 " << (batch.count - pushed) << " 个数据包";
     }
+    batch.count = 0;
+}
+
+// AF_PACKET 抓包：一个线程从环形缓冲取出数据报，按来源IP分配到各分片的队列，直到收到退出信号
+// 槽位只记录负载在块中的位置，解析线程直接读取环形缓冲，没有逐包拷贝
+int capturePackets(PacketRing &ring, const std::string &interface)
+{
+    ThreadTopology::enterStage(ThreadTopology::STAGE_RECEIVE, "ld_capture");
+
+    std::unique_ptr<PacketRecorder> recorder = startRecorder();
+    std::vector<ShardBatch> pending(g_shards.size());
+    std::vector<std::vector<PacketHandle>> spare(g_shards.size());
+
+    LD_INFO << "开始抓包... (接口 " << interface << ", 环形缓冲 " << ring.bufferBytes() / 1024 << " KiB)";
+
+    while (g_running)
+    {
+        int count = ring.nextBlock(CaptureConfig::PollTimeoutMs);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LD_ERROR << "poll() 失败: " << strerror(errno);
+            g_running = false;
+            break;
+        }
+
+        // 整块数据报使用同一个取出时间，用于统计入队和排队耗时
+        const uint64_t batchNs = monotonicNowNs();
+
+        for (int i = 0; i < count; ++i)
+        {
+            const RingPacket &packet = ring.packet(i);
+            g_received_packets++;
+
+            if (packet.truncated || packet.length > PacketConfig::BIG_PACKET_SIZE)
+            {
+                g_dropped_packets++;
+                LD_WARN << "数据包不完整或超出槽位大小，丢弃";
+                continue;
+            }
+
+            if (recorder)
+            {
+                recorder->record(packet.data, packet.length, packet.sourceAddr, packet.rxTimeNs);
+            }
+
+            ReceiveShard &shard = *g_shards[shardOf(packet.sourceAddr & 0xFF)];
+            std::vector<PacketHandle> &reuse = spare[shard.index];
+            PacketHandle handle = InvalidPacketHandle;
+            if (!reuse.empty())
+            {
+                handle = reuse.back();
+                reuse.pop_back();
+            }
+            else if (!shard.pool.acquire(handle))
+            {
+                g_dropped_packets++;
+                LD_WARN << "数据包池已耗尽，丢弃数据包";
+                continue;
+            }
+
+            PacketSlot &slot = shard.pool.slot(handle);
+            slot.payload = packet.data;
+            slot.length = packet.length;
+            slot.ipaddr = packet.sourceAddr & 0xFF;
+            slot.enqueueTimeNs = batchNs;
+            slot.rxTimeNs = packet.rxTimeNs;
+            slot.ringRefs = ring.hold(i);
+
+            ShardBatch &batch = pending[shard.index];
+            batch.handles[batch.count++] = handle;
+            if (batch.count == GlobalConfig::RecvBatchSize)
+            {
+                pushCapturedBatch(shard, batch, reuse);
+            }
+        }
+        for (size_t n = 0; n < pending.size(); ++n)
+        {
+            pushCapturedBatch(*g_shards[n], pending[n], spare[n]);
+        }
+        if (count > 0)
+        {
+            Metrics::recvToEnqueue.observe(monotonicNowNs() - batchNs);
+        }
+
+        // 内核丢包说明环形缓冲不够或解析线程持有块太久
+        const uint64_t drops = count > 0 ? ring.updateKernelStats() : 0;
+        if (drops > 0)
+        {
+            g_kernel_dropped_packets += drops;
+            LD_WARN << "抓包环形缓冲已满，内核丢弃了 " << drops << " 个数据包";
+        }
+
+        // 定期输出抓包统计
+        if (count > 0 && ring.stats().blocks % CaptureConfig::StatsIntervalBlocks == 0)
+        {
+            LD_DEBUG << "抓包统计: " << ring.statsString();
+        }
+    }
+
+    g_kernel_dropped_packets += ring.updateKernelStats();
+    LD_INFO << "抓包统计: " << ring.statsString();
+
+    // 抓包已停止，收尾录制分段
+    if (recorder)
+    {
+        recorder->stop();
+    }
+
+    ThreadTopology::leaveStage();
+    return 0;
+}
+
+// 离线回放：按录制时间把文件中的数据包放入所属分片的缓冲区，rate 为倍速，0 表示不限速
+int replayPackets(const std::vector<std::string> &files, int port, double rate)
+{
+    ReplaySource source(port);
+    if (!source.open(files))
+    {
+        LD_FATAL << "没有可回放的文件";
+        return 1;
+    }
+
+    if (rate > 0)
+    {
+        LD_INFO << "开始回放 " << files.size() << " 个文件，速率: " << rate << "x";
+    }
+    else
+    {
+        LD_INFO << "开始回放 " << files.size() << " 个文件，速率: 不限速";
+    }
+
+    std::vector<ShardBatch> pending(g_shards.size());
+    bool first = true;
+    uint64_t firstTimeNs = 0;
+    std::chrono::steady_clock::time_point startTime;
+    ReplayPacket packet;
+
+    while (g_running && source.next(packet))
+    {
+        g_received_packets++;
+
+        if (packet.length > sizeof(PacketSlot::data))
+        {
+            g_dropped_packets++;
+            LD_WARN << "回放数据包超出槽位大小，丢弃";
+            continue;
+        }
+
+        if (first)
+        {
+            first = false;
+            firstTimeNs = packet.timeNs;
+            startTime = std::chrono::steady_clock::now();
+        }
+        else if (rate > 0)
+        {
+            // 按相对第一个数据包的绝对时间调度，睡眠误差不会累积
+            uint64_t offsetNs = packet.timeNs > firstTimeNs ? packet.timeNs - firstTimeNs : 0;
+            std::chrono::steady_clock::time_point due =
+                startTime + std::chrono::nanoseconds(static_cast<int64_t>(offsetNs / rate));
+            if (due > std::chrono::steady_clock::now())
+            {
+                // 等待前先交出已经到时间的数据包
+                pushAllBatches(pending);
+                std::this_thread::sleep_until(due);
+            }
+        }
+
+        const uint32_t ipaddr = packet.sourceIp & 0xFF; // 与实时接收一致，只取最后一位
+        ReceiveShard &shard = *g_shards[shardOf(ipaddr)];
+        ShardBatch &batch = pending[shard.index];
+
+        PacketHandle handle = InvalidPacketHandle;
+        while (g_running && !shard.pool.acquire(handle))
+        {
+            // 槽位都在途中，先交出手头的数据包再等处理线程归还
+            pushAllBatches(pending);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        if (handle == InvalidPacketHandle)
+        {
+            break;
+        }
+
+        PacketSlot &slot = shard.pool.slot(handle);
+        memcpy(slot.data, packet.data, packet.length);
+        slot.length = static_cast<uint16_t>(packet.length);
+        slot.ipaddr = ipaddr;
+        slot.enqueueTimeNs = monotonicNowNs();
+        slot.rxTimeNs = realtimeNowNs();  // 回放时以放入队列的时间作为接收时间
+
+        batch.handles[batch.count++] = handle;
+        if (batch.count == GlobalConfig::RecvBatchSize)
+        {
+            pushAllHandles(shard, batch.handles, batch.count);
+            batch.count = 0;
+        }
+    }
+    pushAllBatches(pending);
+
+    // 等处理线程取完队列中的数据包再通知退出
+    for (size_t i = 0; i < g_shards.size(); ++i)
+    {
+        while (g_running && !g_shards[i]->buffer.empty())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    g_running = false;
+
+    LD_INFO << "回放结束: 数据包=" << source.packetCount() << ", 跳过的记录=" << source.skippedCount();
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    // 日志由后台线程输出，接收和处理线程只入队，不等待控制台或 syslog
+    if (LogConfig::AsyncOutput && !Logger::startAsync())
+    {
+        LD_ERROR << "日志输出线程启动失败，改为同步输出";
+    }
+
+    LD_INFO << "RK3576 激光雷达点云处理工具 v" << GlobalConfig::Version;
+
+    // 检查向量解码内核与标量实现是否逐位一致，不一致时退回标量实现
+    if (!PayloadDecoder::selfCheck())
+    {
+        LD_ERROR << "解码内核自检未通过，改用标量实现";
+        PayloadDecoder::setScalarOnly(true);
+    }
+    LD_INFO << "负载解码内核: " << PayloadDecoder::backendName(PayloadDecoder::activeBackend());
+
+    // 在程序开始时创建保存目录
+    PointCloudProcessor::ensureDirectoryExists(CloudConfig::save_path);
+
+    // 设置信号处理
+    signal(SIGINT, signalHandler);
+
+    signal(SIGTERM, signalHandler);
+
+    // 解析命令行参数：[端口] [保存格式] [--replay 文件]... [--rate 倍速] [--shards 分片数]
+    //                  [--capture socket|packet] [--interface 接口] [--lidars 雷达数]
+    int port = LidarConfig::listenPort;
+    std::string formatName = CloudConfig::save_format;  // 点云保存格式：配置默认值，可由第二个参数覆盖
+    std::vector<std::string> replayFiles;
+    double replayRate = 1.0;
+    int shardCount = GlobalConfig::ReceiveShards;
+    std::string captureBackend = CaptureConfig::backend;
+    std::string interface = LidarConfig::interfaceName;
+    int lidarCount = std::max<int>(1, static_cast<int>(LidarConfig::getLidarParams().size()));
+    int positional = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--replay" && i + 1 < argc)
+        {
+            replayFiles.push_back(argv[++i]);
+        }
+        else if (arg == "--rate" && i + 1 < argc)
+        {
+            arg = argv[++i];
+            replayRate = (arg == "max") ? 0.0 : atof(arg.c_str());
+            if (replayRate < 0)
+            {
+                LD_ERROR << "回放速率无效: " << arg;
+                return 1;
+            }
+        }
+        else if (arg == "--shards" && i + 1 < argc)
+        {
+            shardCount = atoi(argv[++i]);
+            if (shardCount < 1 || shardCount > GlobalConfig::MaxReceiveShards)
+            {
+                LD_ERROR << "接收分片数无效: " << argv[i] << "，可选 1-" << GlobalConfig::MaxReceiveShards;
+                return 1;
+            }
+        }
+        else if (arg == "--capture" && i + 1 < argc)
+        {
+            captureBackend = argv[++i];
+            if (captureBackend != "socket" && captureBackend != "packet")
+            {
+                LD_ERROR << "未知的接收后端: " << captureBackend << "，可选 socket / packet";
+                return 1;
+            }
+        }
+        else if (arg == "--interface" && i + 1 < argc)
+        {
+            interface = argv[++i];
+        }
+        else if (arg == "--lidars" && i + 1 < argc)
+        {
+            lidarCount = atoi(argv[++i]);
+            if (lidarCount < 1)
+            {
+                LD_ERROR << "雷达数无效: " << argv[i];
+                return 1;
+            }
+        }
+        else if (positional == 0)
+        {
+            port = atoi(argv[i]);
+            positional++;
+        }
+        else if (positional == 1)
+        {
+            formatName = arg;
+            positional++;
+        }
+        else
+        {
+            LD_ERROR << "未知参数: " << arg;
+            return 1;
+        }
+    }
+    if (replayFiles.empty())
+    {
+        LD_INFO << "监听端口: " << port;
+    }
+    else
+    {
+        LD_INFO << "离线回放，雷达数据端口: " << port;
+    }
+
+    CloudFormat saveFormat;
+    if (!PointCloudProcessor::parseCloudFormat(formatName, saveFormat))
+    {
+        LD_ERROR << "未知的点云保存格式: " << formatName << "，可选 ply_ascii / ply_binary / pcd_binary";
+        return 1;
+    }
+    g_processor.setSaveFormat(saveFormat);
+    LD_INFO << "点云保存格式: " << PointCloudProcessor::cloudFormatName(saveFormat);
+
+    // 在分配数据包池和点云池之前锁定内存，之后的分配也常驻内存
+    ThreadTopology::lockMemory();
+
+    // 每个分片独立的数据包池和队列
+    for (int i = 0; i < shardCount; ++i)
+    {
+        g_shards.push_back(std::unique_ptr<ReceiveShard>(new ReceiveShard(i)));
+    }
+    LD_INFO << "接收分片数: " << shardCount;
+
+    // AF_PACKET 抓包后端；环形缓冲在处理线程退出后才释放（队列中的数据包仍指向其中的块）
+    std::unique_ptr<PacketRing> captureRing;
+    if (replayFiles.empty() && captureBackend == "packet")
+    {
+        captureRing.reset(new PacketRing(CaptureConfig::BlockSize, CaptureConfig::BlockCount,
+                                         CaptureConfig::BlockTimeoutMs));
+        if (!captureRing->open(interface, port))
+        {
+            int err = errno;
+            LD_FATAL << "打开 AF_PACKET 抓包套接字失败（接口 " << interface << "）: " << strerror(err)
+                     << (err == EPERM ? "，需要 root 或 CAP_NET_RAW" : "");
+            return 1;
+        }
+
+        const char *multiaddr = LidarConfig::multicastAddr;
+        if (multiaddr && multiaddr[0] != '\0')
+        {
+            if (captureRing->joinMulticast(interface, multiaddr))
+            {
+                LD_INFO << "已在接口 " << interface << " 上接收组播组: " << multiaddr;
+            }
+            else
+            {
+                LD_ERROR << "接收组播组失败: " << strerror(errno);
+            }
+        }
+        LD_INFO << "接收后端: AF_PACKET TPACKET_V3 (接口 " << interface << ")";
+    }
+
+    // 设置点云回调
+    g_processor.setCallback(cloudCallback);
+    g_processor.setSliceCallback(sliceCallback);
+
+    // 运行指标：各阶段延迟和解析计数由各模块记录，这里补充队列、接收和保存相关的指标
+    MetricsRegistry &metrics = Metrics::registry();
+    metrics.addCounter("ldlidar_packets_received_total", "接收的数据包数", &g_received_packets);
+    metrics.addCounter("ldlidar_packets_dropped_total", "用户态丢弃的数据包数（截断、池耗尽、队列满）", &g_dropped_packets);
+    metrics.addCounter("ldlidar_packets_kernel_dropped_total", "内核丢弃的数据包数（接收缓冲区或抓包环形缓冲已满）",
+                       &g_kernel_dropped_packets);
+    metrics.addGauge("ldlidar_packet_queue_depth", "各分片数据包队列当前占用之和", [] {
+        size_t total = 0;
+        for (size_t i = 0; i < g_shards.size(); ++i)
+        {
+            total += g_shards[i]->buffer.size();
+        }
+        return static_cast<double>(total);
+    });
+    metrics.addGauge("ldlidar_packet_queue_high_water", "各分片数据包队列占用高水位的最大值", [] {
+        size_t highest = 0;
+        for (size_t i = 0; i < g_shards.size(); ++i)
+        {
+            highest = std::max(highest, g_shards[i]->buffer.highWaterMark());
+        }
+        return static_cast<double>(highest);
+    });
+    metrics.addGauge("ldlidar_packet_queue_capacity", "单个分片的数据包队列容量",
+                     [] { return static_cast<double>(g_shards[0]->buffer.capacity()); });
+    metrics.addGauge("ldlidar_packet_pool_available", "各分片数据包池空闲槽位数之和", [] {
+        size_t total = 0;
+        for (size_t i = 0; i < g_shards.size(); ++i)
+        {
+            total += g_shards[i]->pool.available();
+        }
+        return static_cast<double>(total);
+    });
+    metrics.addGauge("ldlidar_receive_shards", "接收分片数",
+                     [] { return static_cast<double>(g_shards.size()); });
+    metrics.addCounter("ldlidar_clouds_saved_total", "已保存的点云帧数",
+                       [] { return static_cast<double>(g_processor.savedFrames()); });
+    metrics.addCounter("ldlidar_cloud_saves_dropped_total", "保存队列满丢弃的帧数",
+                       [] { return static_cast<double>(g_processor.droppedSaves()); });
+    metrics.addCounter("ldlidar_log_dropped_total", "日志队列满丢弃的日志条数",
+                       [] { return static_cast<double>(Logger::droppedMessages()); });
+    for (int stage = 0; stage < ThreadTopology::STAGE_COUNT; ++stage)
+    {
+        ThreadTopology::Stage s = static_cast<ThreadTopology::Stage>(stage);
+        metrics.addCounter(std::string("ldlidar_") + ThreadTopology::stageName(s) + "_thread_migrations_total",
+                           std::string(ThreadTopology::stageName(s)) + " 阶段线程在 CPU 间迁移的次数",
+                           [s] { return static_cast<double>(ThreadTopology::stageMigrations(s)); });
+    }
+    MetricsExporter metricsExporter(metrics);
+    if (MetricsConfig::enabled &&
+        !metricsExporter.start(MetricsConfig::path, MetricsConfig::socket_path, MetricsConfig::ExportIntervalMs))
+    {
+        LD_ERROR << "运行指标导出启动失败，继续运行但不导出";
+    }
+
+    // 启动点云保存线程和处理线程
+    g_processor.start();
+    for (size_t i = 0; i < g_shards.size(); ++i)
+    {
+        g_shards[i]->procThread = std::thread(processThread, std::ref(*g_shards[i]));
+    }
+    std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+
+    // 从套接字实时接收、AF_PACKET 抓包或从文件回放，直到退出
+    int result = 0;
+    if (!replayFiles.empty())
+    {
+        result = replayPackets(replayFiles, port, replayRate);
+    }
+    else if (captureRing)
+    {
+        result = capturePackets(*captureRing, interface);
+    }
+    else
+    {
+        result = receivePackets(port, lidarCount);
+    }
+
+    // 确保缓冲区不再阻塞处理线程，等待处理线程结束
+    LD_INFO << "等待点云处理线程退出...";
+    for (auto &shard : g_shards)
+    {
+        shard->buffer.setExit(true);
+        if (shard->procThread.joinable())
+        {
+            shard->procThread.join();
+        }
+
+        // 解析线程已退出，由当前线程归还接收器剩下的槽位
+        shard->pool.releaseBulk(shard->armedHandles.data(), shard->armedHandles.size());
+        shard->armedHandles.clear();
+    }
+
+    // 输出仍在组装中的帧
+    for (auto &shard : g_shards)
+    {
+        for (auto &pair : shard->parsers)
+        {
+            pair.second->flush();
+        }
+    }
+
+    // 回放吞吐：从开始送入数据包到所有帧处理完
+    if (!replayFiles.empty())
+    {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+        if (seconds <= 0)
+        {
+            seconds = 1e-9;
+        }
+        LD_INFO << "回放统计: 耗时=" << std::fixed << std::setprecision(3) << seconds << "s"
+                << ", 数据包=" << g_received_packets.load() << " (" << std::setprecision(0)
+                << g_received_packets.load() / seconds << " 包/s)"
+                << ", 帧=" << g_completed_frames.load() << " (" << std::setprecision(2)
+                << g_completed_frames.load() / seconds << " 帧/s)";
+    }
+
+    // 写完保存队列中的帧，归还点云缓冲后才能清理解析器（点云池属于解析器）
+    g_processor.stop();
+    LD_INFO << "点云保存统计: " << g_processor.saveStatsString();
+
+    // 最后导出一次指标，并在日志中给出各阶段延迟
+    metricsExporter.stop();
+    LD_INFO << "阶段延迟: " << metrics.latencySummary();
 
     // 清理解析器
-    for (auto &pair : g_parsers)
+    for (auto &shard : g_shards)
     {
-        delete pair.second;
+        for (auto &pair : shard->parsers)
+        {
+            LD_INFO << "雷达 " << pair.first << " 点云池: 缓冲数=" << pair.second->cloudPool().capacity()
+                    << ", 池空额外分配=" << pair.second->cloudPool().overflowCount();
+            delete pair.second;
+        }
+        shard->parsers.clear();
     }
-    g_parsers.clear();
 
     // 在程序退出时输出包处理统计信息
     LD_INFO << "程序运行期间接收了 " << g_received_packets.load()
-            << " 个数据包，丢弃了 " << g_dropped_packets.load() << " 个数据包";
+            << " 个数据包，丢弃了 " << g_dropped_packets.load() << " 个数据包，内核丢弃了 "
+            << g_kernel_dropped_packets.load() << " 个数据包";
+    for (auto &shard : g_shards)
+    {
+        LD_INFO << "分片 " << shard->index << " 数据包队列: 容量=" << shard->buffer.capacity()
+                << ", 占用高水位=" << shard->buffer.highWaterMark()
+                << ", 消费者休眠次数=" << shard->buffer.sleepCount()
+                << ", 其他分片的数据报=" << shard->foreignPackets.load();
+    }
+
+    LD_INFO << "线程迁移次数: " << ThreadTopology::report();
 
     LD_INFO << "程序正常退出";
-    return 0;
+    Logger::stopAsync();
+    return result;
 }
\ No newline at end of file
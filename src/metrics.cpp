@@ -0,0 +1,440 @@
+#include "metrics.h"
+#include "logger.h"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+const uint64_t LatencyHistogram::BoundsNs[LatencyHistogram::BoundCount] = {
+    1000ULL, 2500ULL, 5000ULL,
+    10000ULL, 25000ULL, 50000ULL,
+    100000ULL, 250000ULL, 500000ULL,
+    1000000ULL, 2500000ULL, 5000000ULL,
+    10000000ULL, 25000000ULL, 50000000ULL,
+    100000000ULL, 250000000ULL, 500000000ULL,
+    1000000000ULL,
+};
+
+LatencyHistogram::LatencyHistogram() : sumNs_(0)
+{
+    for (int i = 0; i <= BoundCount; ++i)
+    {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::snapshot(uint64_t *buckets) const
+{
+    for (int i = 0; i <= BoundCount; ++i)
+    {
+        buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    uint64_t total = 0;
+    for (int i = 0; i <= BoundCount; ++i)
+    {
+        total += buckets_[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+double LatencyHistogram::quantileNs(double q) const
+{
+    uint64_t buckets[BoundCount + 1];
+    snapshot(buckets);
+    uint64_t total = 0;
+    for (int i = 0; i <= BoundCount; ++i)
+    {
+        total += buckets[i];
+    }
+    if (total == 0)
+    {
+        return 0.0;
+    }
+
+    const double rank = q * total;
+    uint64_t cumulative = 0;
+    for (int i = 0; i <= BoundCount; ++i)
+    {
+        if (buckets[i] == 0 || cumulative + buckets[i] < rank)
+        {
+            cumulative += buckets[i];
+            continue;
+        }
+        if (i == BoundCount)
+        {
+            // +Inf 桶无法插值，返回最大的有限上界
+            return static_cast<double>(BoundsNs[BoundCount - 1]);
+        }
+        const double lower = i == 0 ? 0.0 : static_cast<double>(BoundsNs[i - 1]);
+        const double upper = static_cast<double>(BoundsNs[i]);
+        return lower + (upper - lower) * (rank - cumulative) / buckets[i];
+    }
+    return static_cast<double>(BoundsNs[BoundCount - 1]);
+}
+
+void MetricsRegistry::addCounter(const std::string &name, const std::string &help,
+                                 const std::atomic<uint64_t> *value)
+{
+    Entry e;
+    e.type = COUNTER;
+    e.name = name;
+    e.help = help;
+    e.counter = value;
+    e.histogram = nullptr;
+    entries_.push_back(e);
+}
+
+void MetricsRegistry::addCounter(const std::string &name, const std::string &help, std::function<double()> read)
+{
+    Entry e;
+    e.type = COUNTER;
+    e.name = name;
+    e.help = help;
+    e.counter = nullptr;
+    e.gauge = read;
+    e.histogram = nullptr;
+    entries_.push_back(e);
+}
+
+void MetricsRegistry::addGauge(const std::string &name, const std::string &help, std::function<double()> read)
+{
+    Entry e;
+    e.type = GAUGE;
+    e.name = name;
+    e.help = help;
+    e.counter = nullptr;
+    e.gauge = read;
+    e.histogram = nullptr;
+    entries_.push_back(e);
+}
+
+void MetricsRegistry::addHistogram(const std::string &name, const std::string &help,
+                                   const LatencyHistogram *histogram)
+{
+    Entry e;
+    e.type = HISTOGRAM;
+    e.name = name;
+    e.help = help;
+    e.counter = nullptr;
+    e.histogram = histogram;
+    entries_.push_back(e);
+}
+
+std::string MetricsRegistry::render() const
+{
+    std::ostringstream ss;
+    ss << std::setprecision(9);
+    for (const auto &e : entries_)
+    {
+        ss << "# HELP " << e.name << " " << e.help << "\n";
+        switch (e.type)
+        {
+        case COUNTER:
+            ss << "# TYPE " << e.name << " counter\n" << e.name << " ";
+            if (e.counter != nullptr)
+            {
+                ss << e.counter->load(std::memory_order_relaxed) << "\n";
+            }
+            else
+            {
+                ss << e.gauge() << "\n";
+            }
+            break;
+        case GAUGE:
+            ss << "# TYPE " << e.name << " gauge\n"
+               << e.name << " " << e.gauge() << "\n";
+            break;
+        case HISTOGRAM:
+        {
+            uint64_t buckets[LatencyHistogram::BoundCount + 1];
+            e.histogram->snapshot(buckets);
+            ss << "# TYPE " << e.name << " histogram\n";
+            uint64_t cumulative = 0;
+            for (int i = 0; i < LatencyHistogram::BoundCount; ++i)
+            {
+                cumulative += buckets[i];
+                ss << e.name << "_bucket{le=\"" << LatencyHistogram::BoundsNs[i] / 1e9 << "\"} " << cumulative << "\n";
+            }
+            cumulative += buckets[LatencyHistogram::BoundCount];
+            ss << e.name << "_bucket{le=\"+Inf\"} " << cumulative << "\n"
+               << e.name << "_sum " << e.histogram->sumNs() / 1e9 << "\n"
+               << e.name << "_count " << cumulative << "\n";
+            break;
+        }
+        }
+    }
+    return ss.str();
+}
+
+std::string MetricsRegistry::latencySummary() const
+{
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    for (const auto &e : entries_)
+    {
+        if (e.type != HISTOGRAM)
+        {
+            continue;
+        }
+        if (ss.tellp() > 0)
+        {
+            ss << "; ";
+        }
+        ss << e.name << " 次数=" << e.histogram->count()
+           << " p50=" << e.histogram->quantileNs(0.5) / 1000.0 << "us"
+           << " p99=" << e.histogram->quantileNs(0.99) / 1000.0 << "us";
+    }
+    return ss.str();
+}
+
+namespace Metrics {
+    LatencyHistogram socketWait;
+    LatencyHistogram recvToEnqueue;
+    LatencyHistogram queueWait;
+    LatencyHistogram parsePacket;
+    LatencyHistogram frameAssembly;
+    LatencyHistogram cloudBuild;
+    LatencyHistogram frameCallback;
+    LatencyHistogram cloudSave;
+    LatencyHistogram rxToCallback;
+
+    std::atomic<uint64_t> framesEmitted(0);
+    std::atomic<uint64_t> framesIncomplete(0);
+    std::atomic<uint64_t> framesTimedOut(0);
+    std::atomic<uint64_t> packetsDuplicate(0);
+    std::atomic<uint64_t> packetsLate(0);
+    std::atomic<uint64_t> packetsInvalid(0);
+
+    namespace {
+        MetricsRegistry *createRegistry()
+        {
+            MetricsRegistry *r = new MetricsRegistry();
+            r->addHistogram("ldlidar_socket_wait_seconds", "数据报从内核接收到 recvmmsg 返回的等待时间", &socketWait);
+            r->addHistogram("ldlidar_recv_enqueue_seconds", "recvmmsg 返回到整批放入队列的耗时", &recvToEnqueue);
+            r->addHistogram("ldlidar_queue_wait_seconds", "数据包在队列中等待处理的时间", &queueWait);
+            r->addHistogram("ldlidar_parse_packet_seconds", "单个数据包的解析耗时", &parsePacket);
+            r->addHistogram("ldlidar_frame_assembly_seconds", "帧从第一个数据包到开始构建的时间", &frameAssembly);
+            r->addHistogram("ldlidar_cloud_build_seconds", "构建整帧点云的耗时", &cloudBuild);
+            r->addHistogram("ldlidar_frame_callback_seconds", "帧回调耗时", &frameCallback);
+            r->addHistogram("ldlidar_cloud_save_seconds", "保存一帧点云的耗时", &cloudSave);
+            r->addHistogram("ldlidar_rx_to_callback_seconds", "帧最后一个数据包的内核接收到交给帧回调的时间", &rxToCallback);
+            r->addCounter("ldlidar_frames_emitted_total", "输出的帧数", &framesEmitted);
+            r->addCounter("ldlidar_frames_incomplete_total", "不完整即被强制输出的帧数", &framesIncomplete);
+            r->addCounter("ldlidar_frames_timed_out_total", "超时输出的帧数", &framesTimedOut);
+            r->addCounter("ldlidar_packets_duplicate_total", "重复数据包数", &packetsDuplicate);
+            r->addCounter("ldlidar_packets_late_total", "已输出帧的迟到数据包数", &packetsLate);
+            r->addCounter("ldlidar_packets_invalid_total", "子帧或起始列无效的数据包数", &packetsInvalid);
+            return r;
+        }
+    }
+
+    MetricsRegistry &registry()
+    {
+        // 进程退出前一直使用，不析构，避免与其他静态对象的析构顺序问题
+        static MetricsRegistry *instance = createRegistry();
+        return *instance;
+    }
+}
+
+MetricsExporter::MetricsExporter(const MetricsRegistry &registry)
+    : registry_(registry), intervalMs_(1000), listenFd_(-1)
+{
+    wakeFds_[0] = wakeFds_[1] = -1;
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+bool MetricsExporter::start(const std::string &path, const std::string &socketPath, int intervalMs)
+{
+    path_ = path;
+    socketPath_ = socketPath;
+    intervalMs_ = intervalMs > 0 ? intervalMs : 1000;
+
+    if (!socketPath_.empty())
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (socketPath_.size() >= sizeof(addr.sun_path))
+        {
+            LD_ERROR << "指标套接字路径过长: " << socketPath_;
+            return false;
+        }
+        strncpy(addr.sun_path, socketPath_.c_str(), sizeof(addr.sun_path) - 1);
+
+        listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd_ < 0)
+        {
+            LD_ERROR << "创建指标套接字失败: " << strerror(errno);
+            return false;
+        }
+        // 清理上次运行留下的套接字文件
+        unlink(socketPath_.c_str());
+        if (bind(listenFd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 ||
+            listen(listenFd_, 4) < 0)
+        {
+            LD_ERROR << "指标套接字 " << socketPath_ << " 监听失败: " << strerror(errno);
+            close(listenFd_);
+            listenFd_ = -1;
+            return false;
+        }
+    }
+
+    if (pipe2(wakeFds_, O_CLOEXEC) != 0)
+    {
+        LD_ERROR << "创建指标导出唤醒管道失败: " << strerror(errno);
+        if (listenFd_ >= 0)
+        {
+            close(listenFd_);
+            listenFd_ = -1;
+        }
+        return false;
+    }
+
+    thread_ = std::thread(&MetricsExporter::exportLoop, this);
+    LD_INFO << "运行指标导出已启动: 文件=" << (path_.empty() ? "无" : path_)
+            << ", 套接字=" << (socketPath_.empty() ? "无" : socketPath_) << ", 间隔=" << intervalMs_ << "ms";
+    return true;
+}
+
+void MetricsExporter::stop()
+{
+    if (!thread_.joinable())
+    {
+        return;
+    }
+    const char c = 0;
+    if (write(wakeFds_[1], &c, 1) < 0)
+    {
+        LD_WARN << "唤醒指标导出线程失败: " << strerror(errno);
+    }
+    thread_.join();
+
+    // 退出前最后写一次，文件中保留最终的统计
+    writeFile();
+
+    close(wakeFds_[0]);
+    close(wakeFds_[1]);
+    wakeFds_[0] = wakeFds_[1] = -1;
+    if (listenFd_ >= 0)
+    {
+        close(listenFd_);
+        listenFd_ = -1;
+        unlink(socketPath_.c_str());
+    }
+}
+
+void MetricsExporter::exportLoop()
+{
+    uint64_t nextWrite = monotonicNowNs();
+    for (;;)
+    {
+        const uint64_t now = monotonicNowNs();
+        if (now >= nextWrite)
+        {
+            writeFile();
+            nextWrite = now + static_cast<uint64_t>(intervalMs_) * 1000000ULL;
+        }
+
+        struct pollfd fds[2];
+        fds[0].fd = wakeFds_[0];
+        fds[0].events = POLLIN;
+        fds[1].fd = listenFd_;
+        fds[1].events = POLLIN;
+        const int timeoutMs = static_cast<int>((nextWrite - now + 999999) / 1000000);
+        int n = poll(fds, listenFd_ >= 0 ? 2 : 1, timeoutMs);
+        if (n < 0 && errno != EINTR)
+        {
+            LD_ERROR << "指标导出 poll() 失败: " << strerror(errno);
+            break;
+        }
+        if (n <= 0)
+        {
+            continue;
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            break;
+        }
+        if (listenFd_ >= 0 && (fds[1].revents & POLLIN))
+        {
+            int client = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client >= 0)
+            {
+                serveClient(client);
+                close(client);
+            }
+        }
+    }
+}
+
+bool MetricsExporter::writeFile()
+{
+    if (path_.empty())
+    {
+        return true;
+    }
+
+    const std::string text = registry_.render();
+    const std::string tmpPath = path_ + ".tmp";
+    FILE *fp = fopen(tmpPath.c_str(), "w");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+    const bool ok = fwrite(text.data(), 1, text.size(), fp) == text.size();
+    if (fclose(fp) != 0 || !ok)
+    {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    // 改名是原子的，读取方不会看到写了一半的文件
+    return rename(tmpPath.c_str(), path_.c_str()) == 0;
+}
+
+void MetricsExporter::serveClient(int fd)
+{
+    // 等待请求最多 100ms：HTTP 客户端会先发请求行，socat 等工具可以什么都不发
+    char request[512];
+    ssize_t received = 0;
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 100) > 0)
+    {
+        received = recv(fd, request, sizeof(request), MSG_DONTWAIT);
+    }
+
+    const std::string body = registry_.render();
+    std::string response;
+    if (received >= 3 && memcmp(request, "GET", 3) == 0)
+    {
+        response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                   std::to_string(body.size()) + "\r\n\r\n";
+    }
+    response += body;
+
+    size_t sent = 0;
+    while (sent < response.size())
+    {
+        ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
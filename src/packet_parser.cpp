@@ -1,6 +1,9 @@
 #include "packet_parser.h"
 #include "logger.h"
 #include "config.h"
+#include "payload_decoder.h"
+#include "metrics.h"
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <cstddef>
@@ -11,29 +14,38 @@
 #define ENABLE_POINT_FILTERING 0
 #endif
 
+namespace {
+    // 帧ID是循环计数，按有符号差值比较先后
+    inline int32_t frameIdDiff(uint32_t a, uint32_t b)
+    {
+        return static_cast<int32_t>(a - b);
+    }
+}
+
 PacketParser::PacketParser()
-    : currentFrameId(0), frameInProgress(false),
+    : // 每个缓冲预留整帧点数，外加紧凑写入末尾多写的一个点
+      cloudPool_(CloudConfig::pool_size,
+                 static_cast<size_t>(PacketConfig::LD_LM_LIDAR_WIDTH) * PacketConfig::LD_LM_LIDAR_HEIGHT *
+                     PacketConfig::EchoNumberOfPixel + 1),
       cloudWidth(PacketConfig::LD_LM_LIDAR_WIDTH),
       cloudHeight(PacketConfig::LD_LM_LIDAR_HEIGHT),
-      packetCount(0), processed_points_(0)
+      processed_points_(0)
 {
+    offset_[0] = offset_[1] = offset_[2] = 0.0f;
+
     // 初始化算法参数
     algorithmParam.EnableEchoChose = 1;
     algorithmParam.EchoNumber = 5;
 
-    // 初始化点云存储空间
-    points.resize(cloudWidth * cloudHeight * PacketConfig::EchoNumberOfPixel);
-
-    // 初始化3D点云数据结构
-    pointData_.resize(cloudHeight);
-    for (int i = 0; i < cloudHeight; i++)
+    // 预先分配所有组装槽位，运行期间不再分配帧网格
+    for (int i = 0; i < FrameConfig::AssemblySlots; ++i)
     {
-        pointData_[i].resize(cloudWidth);
-        for (int j = 0; j < cloudWidth; j++)
-        {
-            pointData_[i][j].resize(PacketConfig::EchoNumberOfPixel);
-        }
+        slots_.push_back(std::unique_ptr<FrameSlot>(
+            new FrameSlot(cloudHeight, cloudWidth, PacketConfig::EchoNumberOfPixel)));
     }
+
+    LD_DEBUG << "帧组装槽位初始化: " << slots_.size() << " 个, 每个帧网格 "
+             << slots_[0]->grid.memoryBytes() << " 字节";
 }
 
 PacketParser::~PacketParser()
@@ -44,6 +56,11 @@ PacketParser::~PacketParser()
 void PacketParser::setLidarParam(const LidarParam &param)
 {
     lidarParam = param;
+
+    // 外参平移由解码内核在换算时一并完成
+    offset_[0] = param.x;
+    offset_[1] = param.y;
+    offset_[2] = param.z;
     LD_INFO << "设置雷达参数: " << param.toString();
 }
 
@@ -58,7 +75,7 @@ bool PacketParser::isValidMessage(size_t size)
     return true;
 }
 
-bool PacketParser::parsePacket(const uint8_t *data, size_t size, PointCloud &cloud)
+bool PacketParser::parsePacket(const uint8_t *data, size_t size, uint64_t rxTimeNs)
 {
     // 检查是否为有效的雷达数据包
     if (!isValidMessage(size))
@@ -68,176 +85,373 @@ bool PacketParser::parsePacket(const uint8_t *data, size_t size, PointCloud &clo
 
     // 重新映射数据以便访问
     const Gen2Packet *packet = reinterpret_cast<const Gen2Packet *>(data);
+    uint32_t frameId = ntohl(packet->head.frameId);
 
-    // 检查是否是新的帧ID
-    bool isNewFrame = false;
-    if (frameInProgress && ntohl(packet->head.frameId) != currentFrameId)
+    // 由子帧ID和起始列ID确定该包在帧内的槽位
+    int slotIndex = FrameCoverage::slotIndex(packet->head.subFrameId, packet->head.startColId);
+    if (slotIndex < 0)
     {
-        LD_WARN << "检测到新帧ID(" << ntohl(packet->head.frameId)
-                << ")，但上一帧(" << currentFrameId
+        invalidPackets_++;
+        Metrics::packetsInvalid.fetch_add(1, std::memory_order_relaxed);
+        LD_WARN << "无效的子帧/起始列: " << (int)packet->head.subFrameId
+                << "/" << (int)packet->head.startColId << "，丢弃数据包";
+        return false;
+    }
 
-        << ")仅接收到" << packets_[currentFrameId] << "个包，强制结束上一帧";
+    // 已经输出过的帧的迟到包直接丢弃，避免混入其他帧
+    if (isLateFrame(frameId))
+    {
+        latePackets_++;
+        Metrics::packetsLate.fetch_add(1, std::memory_order_relaxed);
+        LD_DEBUG << "丢弃已输出帧的迟到包: 帧ID=" << frameId;
+        return false;
+    }
+
+    int emitted = 0;
+    FrameSlot *slot = acquireSlot(frameId, emitted);
+    if (slot == nullptr)
+    {
+        latePackets_++;
+        Metrics::packetsLate.fetch_add(1, std::memory_order_relaxed);
+        return emitted > 0;
+    }
 
-        // 处理未完成的上一帧数据
-        if (packets_[currentFrameId] > 0)
+    // 增加当前帧的包计数（包含重复包）
+    slot->packetCount++;
+
+    // 记录覆盖位图，重复包不再解码
+    if (!slot->coverage.mark(slotIndex))
+    {
+        duplicatePackets_++;
+        Metrics::packetsDuplicate.fetch_add(1, std::memory_order_relaxed);
+        LD_DEBUG << "重复数据包: 帧ID=" << frameId << ", 子帧: " << (int)packet->head.subFrameId
+                 << ", 起始列: " << (int)packet->head.startColId;
+        return emitted > 0;
+    }
+
+    // 记录本帧数据包的内核接收时间范围
+    if (rxTimeNs != 0)
+    {
+        if (slot->rxFirstNs == 0 || rxTimeNs < slot->rxFirstNs)
         {
-            buildPointCloud(cloud);
-            LD_WARN << "强制结束上一帧，由" << packets_[currentFrameId] << "个包构建，点云大小：" << cloud.points.size();
-            isNewFrame = true;
+            slot->rxFirstNs = rxTimeNs;
+        }
+        if (rxTimeNs > slot->rxLastNs)
+        {
+            slot->rxLastNs = rxTimeNs;
         }
-
-        // 重置为新帧
-        frameInProgress = false;
     }
 
-    // 如果不是在处理一个帧或者是新帧，则初始化新帧
-    if (!frameInProgress || ntohl(packet->head.frameId) != currentFrameId)
+    // 记录子帧第一个数据包的时间
+    const int subFrameId = packet->head.subFrameId;
+    if (slot->coverage.subFrameCount(subFrameId) == 1)
     {
-        currentFrameId = ntohl(packet->head.frameId);
-        frameInProgress = true;
-        packets_[currentFrameId] = 0;
-        frameCloud.points.clear();
-        receivedSubframes.clear(); // 清除子帧记录
-        LD_INFO << "开始新帧: 帧ID=" << currentFrameId;
+        slot->subFrameTime[subFrameId] = packet->head.getTimestamp();
     }
 
-    // 增加当前帧的包计数
-    packets_[currentFrameId]++;
+    // 处理有效的雷达数据包
+    processPacket(*slot, packet);
 
-    // 记录已收到的子帧和起始列
-    receivedSubframes.insert(std::make_pair(packet->head.subFrameId, packet->head.startColId));
+    // 流式模式：子帧收齐后立即输出切片
+    if (sliceCallback_ && slot->coverage.subFrameComplete(subFrameId))
+    {
+        emitSlice(*slot, subFrameId);
+    }
 
-    // 处理有效的雷达数据包
-    processPacket(packet);
+    // 判断帧是否结束：覆盖位图的所有槽位都已收到
+    if (slot->coverage.complete())
+    {
+        LD_INFO << "检测到帧结束，帧ID: " << frameId
+                << ", 包数: " << slot->packetCount;
 
-    // 如果前面已经处理了未完成的旧帧，则直接返回
-    if (isNewFrame)
+        // 更旧的未完整帧不会再有数据，先按帧ID顺序输出
+        emitted += finalizeOlderThan(*slot, true);
+        finalizeSlot(*slot);
+        emitted++;
+    }
+    else
     {
-        return true;
+        // 新帧收到足够多的包后，旧帧的重排窗口结束
+        emitted += finalizeOlderThan(*slot, false);
     }
 
-    // 判断帧是否结束，简化为检测是否达到1664个包
-    bool frame_end = (packets_[currentFrameId] >= 1664);
+    return emitted > 0;
+}
 
-    if (frame_end)
+bool PacketParser::isLateFrame(uint32_t frameId) const
+{
+    if (!hasFinalized_)
     {
-        LD_INFO << "检测到帧结束，帧ID: " << ntohl(packet->head.frameId)
-                << ", 包数: " << packets_[currentFrameId];
+        return false;
+    }
+    int32_t behind = frameIdDiff(lastFinalizedId_, frameId);
+    return behind >= 0 && behind < FrameConfig::LateFrameHorizon;
+}
 
-        // 构建点云
-        buildPointCloud(cloud);
+FrameSlot *PacketParser::oldestActiveSlot()
+{
+    FrameSlot *oldest = nullptr;
+    for (size_t i = 0; i < slots_.size(); ++i)
+    {
+        FrameSlot *s = slots_[i].get();
+        if (s->active && (oldest == nullptr || frameIdDiff(s->frameId, oldest->frameId) < 0))
+        {
+            oldest = s;
+        }
+    }
+    return oldest;
+}
 
-        LD_WARN << "！！！点云构建完成，由" << packets_[currentFrameId] << "个包构建，点云大小：" << cloud.points.size();
+FrameSlot *PacketParser::acquireSlot(uint32_t frameId, int &emitted)
+{
+    FrameSlot *freeSlot = nullptr;
+    for (size_t i = 0; i < slots_.size(); ++i)
+    {
+        FrameSlot *s = slots_[i].get();
+        if (s->active && s->frameId == frameId)
+        {
+            return s;
+        }
+        if (!s->active && freeSlot == nullptr)
+        {
+            freeSlot = s;
+        }
+    }
 
-        // 检查点云大小
-        if (cloud.points.empty())
+    // 新帧：没有空闲槽位时结束最旧的帧腾出槽位
+    if (freeSlot == nullptr)
+    {
+        FrameSlot *oldest = oldestActiveSlot();
+        if (frameIdDiff(frameId, oldest->frameId) < 0)
         {
-            LD_WARN << "帧完整，但点云构建后为空！检查点云过滤条件。";
+            // 比所有组装中的帧都旧，且槽位已满，按迟到包处理
+            LD_DEBUG << "丢弃超出重排窗口的旧帧数据包: 帧ID=" << frameId;
+            return nullptr;
+        }
 
-            // 添加额外诊断信息
-            int validPointCount = 0;
-            for (int row = 0; row < cloudHeight; ++row)
+        LD_WARN << "检测到新帧ID(" << frameId << ")，组装槽位已满，强制结束帧("
+                << oldest->frameId << ")";
+        finalizeSlot(*oldest);
+        emitted++;
+        freeSlot = oldest;
+    }
+
+    freeSlot->active = true;
+    freeSlot->frameId = frameId;
+    freeSlot->packetCount = 0;
+    freeSlot->coverage.clear();
+    freeSlot->startTime = std::chrono::steady_clock::now();
+    freeSlot->rxFirstNs = 0;
+    freeSlot->rxLastNs = 0;
+    // 子帧时间只在收到该子帧第一个包时写入，清零避免缺失的子帧沿用之前帧的时间
+    std::fill(freeSlot->subFrameTime, freeSlot->subFrameTime + FrameCoverage::SubFrameCount, 0);
+    LD_DEBUG << "开始新帧: 帧ID=" << frameId;
+
+    // 超出帧ID窗口的旧帧立即结束
+    emitted += finalizeOlderThan(*freeSlot, false);
+    return freeSlot;
+}
+
+int PacketParser::finalizeOlderThan(const FrameSlot &newest, bool force)
+{
+    int finalized = 0;
+    for (;;)
+    {
+        // 每次取最旧的一帧，保证输出按帧ID顺序
+        FrameSlot *oldest = nullptr;
+        for (size_t i = 0; i < slots_.size(); ++i)
+        {
+            FrameSlot *s = slots_[i].get();
+            if (!s->active || s == &newest || frameIdDiff(s->frameId, newest.frameId) >= 0)
             {
-                for (int col = 0; col < cloudWidth; ++col)
-                {
-                    for (int echo = 0; echo < 3; ++echo)
-                    {
-                        Point3D &point = pointData_[row][col][echo];
-                        if (point.x != 0.0f || point.y != 0.0f || point.z != 0.0f)
-                        {
-                            cloud.points.push_back(point);
-                            validPointCount++;
-                        }
-                    }
-                }
+                continue;
             }
-
-            if (validPointCount > 0)
+            if (oldest == nullptr || frameIdDiff(s->frameId, oldest->frameId) < 0)
             {
-                LD_INFO << "手动添加有效点后，点云大小: " << cloud.points.size();
+                oldest = s;
             }
         }
-        else
+        if (oldest == nullptr)
         {
-            LD_INFO << "帧完整，点云大小: " << cloud.points.size();
+            break;
         }
 
-        // 重置当前帧
-        frameInProgress = false;
-        return true;
-    }
+        bool expired = force ||
+                       newest.packetCount >= FrameConfig::ReorderPacketWindow ||
+                       frameIdDiff(newest.frameId, oldest->frameId) > FrameConfig::ReorderFrameWindow;
+        if (!expired)
+        {
+            break;
+        }
 
-    return false;
+        LD_WARN << "新帧(" << newest.frameId << ")已收到" << newest.packetCount
+                << "个包，结束上一帧(" << oldest->frameId << ")";
+        finalizeSlot(*oldest);
+        finalized++;
+    }
+    return finalized;
 }
 
-void PacketParser::transformPoint(float &x, float &y, float &z)
+void PacketParser::finalizeSlot(FrameSlot &slot)
 {
-    float temp_x = x;
-    float temp_y = y;
-    float temp_z = z;
+    if (!slot.coverage.complete())
+    {
+        incompleteFrames_++;
+        Metrics::framesIncomplete.fetch_add(1, std::memory_order_relaxed);
+        LD_WARN << "帧(" << slot.frameId << ")仅接收到" << slot.coverage.count() << "/"
+                << FrameCoverage::SlotCount << "个包，强制结束，缺失: " << slot.coverage.missingSummary();
+    }
 
-    // 使用lidarParam进行点云变换
-    x = temp_x;
-    y = temp_y;
-    z = temp_z;
+    // 在回收的缓冲中构建点云，上一帧的缓冲在下游全部释放后回到池中
+    const std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+    Metrics::frameAssembly.observe(std::chrono::duration_cast<std::chrono::nanoseconds>(buildStart - slot.startTime).count());
+    lastCloud_ = cloudPool_.acquire();
+    PointCloud &frameCloud = *lastCloud_;
+    buildPointCloud(slot, frameCloud);
+    Metrics::cloudBuild.observe(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - buildStart).count());
+    frameCloud.timing.rx_first_ns = slot.rxFirstNs;
+    frameCloud.timing.rx_last_ns = slot.rxLastNs;
+    frameCloud.timing.parse_done_ns = realtimeNowNs();
+    frameCloud.timing.callback_ns = 0;
+
+    LD_DEBUG << "！！！点云构建完成，由" << slot.coverage.count() << "个包构建，点云大小：" << frameCloud.points.size();
+
+    // 检查点云大小
+    if (frameCloud.points.empty())
+    {
+        LD_WARN << "帧(" << slot.frameId << ")点云构建后为空！检查点云过滤条件。";
+    }
+    else
+    {
+        LD_INFO << "帧完整，点云大小: " << frameCloud.points.size();
+    }
 
-    // 如果lidarParam有坐标偏移，则应用它
-    if (lidarParam.x != 0.0f || lidarParam.y != 0.0f || lidarParam.z != 0.0f)
+    // 记录最近输出的帧ID，之后该帧的迟到包会被丢弃
+    if (!hasFinalized_ || frameIdDiff(slot.frameId, lastFinalizedId_) > 0)
     {
-        x += lidarParam.x;
-        y += lidarParam.y;
-        z += lidarParam.z;
+        lastFinalizedId_ = slot.frameId;
+        hasFinalized_ = true;
     }
 
-    // 这里可以添加更复杂的变换，如旋转等
+    // 释放槽位，清空帧网格，避免旧帧的点残留到下一帧
+    slot.grid.clear();
+    slot.coverage.clear();
+    slot.active = false;
+
+    Metrics::framesEmitted.fetch_add(1, std::memory_order_relaxed);
+    if (frameCallback_)
+    {
+        frameCloud.timing.callback_ns = realtimeNowNs();
+        if (slot.rxLastNs != 0 && frameCloud.timing.callback_ns > slot.rxLastNs)
+        {
+            Metrics::rxToCallback.observe(frameCloud.timing.callback_ns - slot.rxLastNs);
+        }
+        const uint64_t callbackStart = monotonicNowNs();
+        frameCallback_(lastCloud_);
+        Metrics::frameCallback.observe(monotonicNowNs() - callbackStart);
+    }
 }
 
-// 构建点云
-void PacketParser::buildPointCloud(PointCloud &cloud)
+int PacketParser::flushExpired(std::chrono::steady_clock::time_point now)
 {
-    LD_DEBUG << "开始构建点云，帧ID: " << currentFrameId;
+    const std::chrono::milliseconds timeout(FrameConfig::FlushTimeoutMs);
+    int finalized = 0;
+    for (;;)
+    {
+        // 超时的帧按帧ID顺序输出
+        FrameSlot *expired = nullptr;
+        for (size_t i = 0; i < slots_.size(); ++i)
+        {
+            FrameSlot *s = slots_[i].get();
+            if (s->active && now - s->startTime >= timeout &&
+                (expired == nullptr || frameIdDiff(s->frameId, expired->frameId) < 0))
+            {
+                expired = s;
+            }
+        }
+        if (expired == nullptr)
+        {
+            break;
+        }
 
-    cloud.clear();
-    cloud.frame_id = currentFrameId;
+        LD_WARN << "帧(" << expired->frameId << ")超过" << FrameConfig::FlushTimeoutMs
+                << "ms未完整，按超时输出";
+        timeoutFrames_++;
+        Metrics::framesTimedOut.fetch_add(1, std::memory_order_relaxed);
+        finalizeSlot(*expired);
+        finalized++;
+    }
+    return finalized;
+}
 
-    int validPointCount = 0;
-    int invalidPointCount = 0;
-    int zeroPointCount = 0;
+int PacketParser::flush()
+{
+    int finalized = 0;
+    FrameSlot *oldest;
+    while ((oldest = oldestActiveSlot()) != nullptr)
+    {
+        finalizeSlot(*oldest);
+        finalized++;
+    }
+    return finalized;
+}
 
-    // 预先分配空间以提高效率
-    cloud.points.reserve(cloudWidth * cloudHeight * EchoNumberOfPixel / 2);
+// 构建点云
+void PacketParser::buildPointCloud(const FrameSlot &slot, PointCloud &cloud)
+{
+    LD_DEBUG << "开始构建点云，帧ID: " << slot.frameId;
 
-    // 遍历点云数据
-    for (int row = 0; row < cloudHeight; ++row)
+    cloud.frame_id = slot.frameId;
+    cloud.coverage = slot.coverage;
+    // 帧时间取实际收到的第一个子帧的时间，子帧0丢失时不能用0或之前帧的时间
+    cloud.timestamp = 0.0;
+    for (int sub = 0; sub < FrameCoverage::SubFrameCount; ++sub)
     {
-        for (int col = 0; col < cloudWidth; ++col)
+        if (slot.coverage.subFrameCount(sub) > 0)
         {
-            for (int echo = 0; echo < EchoNumberOfPixel; ++echo)
-            {
-                Point3D &point = pointData_[row][col][echo];
-
-                // 筛选有效点
-                if (point.x != 0.0f || point.y != 0.0f || point.z != 0.0f)
-                {
-                    cloud.points.push_back(point);
-                    validPointCount++;
-                }
-                else
-                {
-                    zeroPointCount++;
-                }
-            }
+            cloud.timestamp = slot.subFrameTime[sub] / 1e6;
+            break;
         }
     }
 
+    // 解码时已剔除零点并按行统计有效点数，按有效点数一次性分配输出，
+    // 再跳过空行、无分支地把有效点紧凑写入
+    const FrameGrid &grid = slot.grid;
+    cloud.points.resize(grid.validCount() + 1);
+    const size_t validPointCount = grid.compactRows(0, grid.rows(), cloud.points.data());
+    cloud.points.resize(validPointCount);
+
     // 更新点云元数据
     cloud.width = cloud.points.size();
     cloud.height = 1;
     cloud.is_dense = false;
 
     LD_INFO << "点云构建完成，有效点: " << validPointCount
-            << ", 无效点: " << invalidPointCount
-            << ", 原始零点: " << zeroPointCount;
+            << ", 无效点(含零点): " << grid.size() - validPointCount;
+}
+
+void PacketParser::emitSlice(const FrameSlot &slot, int subFrameId)
+{
+    const FrameGrid &grid = slot.grid;
+    const int rowBegin = subFrameId * PacketConfig::ROWS_PER_SUBFRAME;
+    const int rowEnd = std::min(rowBegin + PacketConfig::ROWS_PER_SUBFRAME, grid.rows());
+    if (rowBegin >= rowEnd)
+    {
+        return;
+    }
+
+    sliceCloud_.frame_id = slot.frameId;
+    sliceCloud_.sub_frame_id = static_cast<uint8_t>(subFrameId);
+    sliceCloud_.row_begin = static_cast<uint16_t>(rowBegin);
+    sliceCloud_.row_end = static_cast<uint16_t>(rowEnd);
+    sliceCloud_.timestamp = slot.subFrameTime[subFrameId] / 1e6;
+
+    // 子帧的行在帧网格中是连续的一段
+    sliceCloud_.points.resize(grid.validCount(rowBegin, rowEnd) + 1);
+    sliceCloud_.points.resize(grid.compactRows(rowBegin, rowEnd, sliceCloud_.points.data()));
+
+    sliceCallback_(sliceCloud_);
 }
 
 // 检查是否是一帧的结束
@@ -254,7 +468,7 @@ bool PacketParser::isFrameEnd(const Gen2Packet *packet)
 }
 
 // 处理数据包
-void PacketParser::processPacket(const Gen2Packet *packet)
+void PacketParser::processPacket(FrameSlot &slot, const Gen2Packet *packet)
 {
     // 提取子帧ID和起始列ID
     uint8_t subFrameId = packet->head.subFrameId;
@@ -268,18 +482,33 @@ void PacketParser::processPacket(const Gen2Packet *packet)
 
     LD_DEBUG << "处理子帧: " << (int)subFrameId << ", 起始列: " << (int)startColId;
 
-    // 获取列数
-    int colNum = (startColId == 255) ? 1 : 5;
+    // 字节序翻转、坐标换算、外参平移和写入帧网格由解码内核一次完成
+    size_t decoded = PayloadDecoder::decodePacket(packet, slot.grid, offset_);
+
+#if ENABLE_POINT_FILTERING
+    // 应用回波选择算法（仅在启用过滤时），未选中的回波重置为无效点
+    applyEchoFilter(slot.grid, packet);
+#else
+    // 禁用过滤，所有点都保留
+    processed_points_ += decoded;
+#endif
+}
+
+// 按回波选择算法过滤刚解码的数据包
+void PacketParser::applyEchoFilter(FrameGrid &grid, const Gen2Packet *packet)
+{
+    uint8_t subFrameId = packet->head.subFrameId;
+    uint8_t startColId = packet->head.startColId;
+    int colNum = (startColId == 255) ? 1 : PacketConfig::COLS_PER_PACKET;
 
-    // 处理每一列和每一行的数据
     for (int col = 0; col < colNum; ++col)
     {
-        for (int row = 0; row < 6; ++row)
+        for (int row = 0; row < PacketConfig::ROWS_PER_SUBFRAME; ++row)
         {
-            const Payload &payload = packet->payload[col * 6 + row];
+            const Payload &payload = packet->payload[col * PacketConfig::ROWS_PER_SUBFRAME + row];
 
             // 计算当前行和列的全局索引
-            int curRow = subFrameId * 6 + row;
+            int curRow = subFrameId * PacketConfig::ROWS_PER_SUBFRAME + row;
             int curCol = startColId + col;
 
             // 确保不越界
@@ -288,34 +517,8 @@ void PacketParser::processPacket(const Gen2Packet *packet)
                 continue;
             }
 
-            // 处理每个回波的数据
             for (int echoId = 0; echoId < EchoNumberOfPixel; ++echoId)
             {
-                // 从payload中读取原始坐标数据
-                int16_t x = ntohs(payload.GetX(echoId));
-                int16_t y = ntohs(payload.GetY(echoId));
-                int16_t z = ntohs(payload.GetZ(echoId));
-                uint8_t intensity = payload.GetReflectivity(echoId);
-
-                // 计算点的索引
-                int globalIndex = (curRow * cloudWidth + curCol) * EchoNumberOfPixel + echoId;
-
-                // 确保不越界
-                if (globalIndex >= points.size())
-                {
-                    continue;
-                }
-
-                // 转换坐标
-                float x_f = static_cast<float>(x / 512.0);
-                float y_f = static_cast<float>(y / 512.0);
-                float z_f = static_cast<float>(z / 512.0);
-
-                // 保存坐标和强度
-                Point3D &point = pointData_[curRow][curCol][echoId];
-
-#if ENABLE_POINT_FILTERING
-                // 应用回波选择算法（仅在启用过滤时）
                 bool validPoint = true;
                 if (algorithmParam.EnableEchoChose == 1)
                 {
@@ -341,42 +544,13 @@ void PacketParser::processPacket(const Gen2Packet *packet)
 
                 if (validPoint)
                 {
-                    // 应用坐标变换
-                    float new_x = x_f;
-                    float new_y = y_f;
-                    float new_z = z_f;
-
-                    transformPoint(new_x, new_y, new_z);
-
-                    point.x = new_x;
-                    point.y = new_y;
-                    point.z = new_z;
-                    point.intensity = intensity;
                     processed_points_++;
                 }
                 else
                 {
                     // 无效点设置为零
-                    point.x = 0.0f;
-                    point.y = 0.0f;
-                    point.z = 0.0f;
-                    point.intensity = 0;
+                    grid.reset(grid.index(curRow, curCol, echoId));
                 }
-#else
-                // 禁用过滤，所有点都保留
-                // 应用坐标变换
-                float new_x = x_f;
-                float new_y = y_f;
-                float new_z = z_f;
-
-                transformPoint(new_x, new_y, new_z);
-
-                point.x = new_x;
-                point.y = new_y;
-                point.z = new_z;
-                point.intensity = intensity;
-                processed_points_++;
-#endif
             }
         }
     }
@@ -386,8 +560,22 @@ void PacketParser::processPacket(const Gen2Packet *packet)
 void PacketParser::printDiagnostics()
 {
     LD_INFO << "诊断信息：已处理点数=" << processed_points_
-            << ", 当前帧ID=" << currentFrameId
-            << ", 当前帧包数=" << (packets_.count(currentFrameId) ? packets_[currentFrameId] : 0)
+            << ", 重复包=" << duplicatePackets_
+            << ", 无效包=" << invalidPackets_
+            << ", 迟到包=" << latePackets_
+            << ", 不完整帧=" << incompleteFrames_
+            << ", 超时帧=" << timeoutFrames_
             << ", 最大子帧ID=" << (int)maxSubFrameId
             << ", 最大起始列ID=" << (int)maxStartColId;
+
+    for (size_t i = 0; i < slots_.size(); ++i)
+    {
+        const FrameSlot &slot = *slots_[i];
+        if (slot.active)
+        {
+            LD_INFO << "组装中的帧: 帧ID=" << slot.frameId
+                    << ", 包数=" << slot.packetCount
+                    << ", 覆盖=" << slot.coverage.count() << "/" << FrameCoverage::SlotCount;
+        }
+    }
 }
@@ -0,0 +1,61 @@
+#include "packet_pool.h"
+#include "logger.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+PacketPool::PacketPool(size_t capacity)
+    : slots_(nullptr), capacity_(capacity), freeList_(capacity)
+{
+    // C++11 的 new 不保证超过 alignof(max_align_t) 的对齐，这里手动按缓存行分配
+    void *mem = nullptr;
+    if (posix_memalign(&mem, GlobalConfig::CacheLineSize, sizeof(PacketSlot) * capacity_) != 0)
+    {
+        LD_FATAL << "数据包池分配失败，槽位数: " << capacity_;
+        throw std::bad_alloc();
+    }
+    slots_ = static_cast<PacketSlot *>(mem);
+    memset(slots_, 0, sizeof(PacketSlot) * capacity_);
+    for (size_t i = 0; i < capacity_; ++i)
+    {
+        slots_[i].payload = slots_[i].data;
+    }
+
+    // 按地址顺序放入空闲队列
+    for (size_t i = 0; i < capacity_; ++i)
+    {
+        freeList_.push(static_cast<PacketHandle>(i));
+    }
+
+    LD_INFO << "数据包池初始化: " << capacity_ << " 个槽位, 每槽 " << sizeof(PacketSlot) << " 字节";
+}
+
+PacketPool::~PacketPool()
+{
+    free(slots_);
+}
+
+bool PacketPool::acquire(PacketHandle &handle)
+{
+    return freeList_.tryPop(handle);
+}
+
+size_t PacketPool::acquireBulk(PacketHandle *handles, size_t count)
+{
+    return freeList_.tryPopBulk(handles, count);
+}
+
+void PacketPool::release(PacketHandle handle)
+{
+    freeList_.push(handle);
+}
+
+void PacketPool::releaseBulk(const PacketHandle *handles, size_t count)
+{
+    freeList_.pushBulk(handles, count);
+}
+
+size_t PacketPool::available() const
+{
+    return freeList_.size();
+}
@@ -0,0 +1,360 @@
+#include "packet_recorder.h"
+#include "point_cloud.h"
+#include "pktdata.h"
+#include "logger.h"
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+
+PacketRecorder::PacketRecorder(const std::string &directory, size_t segmentBytes, int segmentSeconds,
+                               int blackBoxSeconds, int frameIndexCapacity)
+    : directory_(directory),
+      segmentBytes_(segmentBytes),
+      segmentNs_(static_cast<uint64_t>(segmentSeconds) * 1000000000ULL),
+      blackBoxSeconds_(blackBoxSeconds),
+      frameIndexCapacity_(frameIndexCapacity),
+      headerBytes_(RawRecord::headerBytes(frameIndexCapacity)),
+      current_(nullptr), currentStartNs_(0), lastFrameCount_(0),
+      ready_(nullptr), needSegment_(false), stopping_(false), nextSequence_(0),
+      records_(0), bytes_(0), dropped_(0), segments_(0), deleted_(0)
+{
+}
+
+PacketRecorder::~PacketRecorder()
+{
+    stop();
+}
+
+bool PacketRecorder::start()
+{
+    if (!PointCloudProcessor::ensureDirectoryExists(directory_))
+    {
+        return false;
+    }
+
+    // 本次录制的分段文件以启动时间为前缀，按序号递增
+    std::time_t now = std::time(nullptr);
+    std::tm now_tm;
+    localtime_r(&now, &now_tm);
+    std::ostringstream ss;
+    ss << std::put_time(&now_tm, "%Y%m%d_%H%M%S");
+    sessionName_ = ss.str();
+
+    current_ = createSegment(nextSequence_++);
+    if (current_ == nullptr)
+    {
+        return false;
+    }
+
+    // 后台线程立即准备下一个分段
+    needSegment_ = true;
+    stopping_ = false;
+    helper_ = std::thread(&PacketRecorder::helperLoop, this);
+
+    LD_INFO << "原始数据包录制已启动: 目录=" << directory_ << ", 分段大小=" << segmentBytes_ / (1024 * 1024)
+            << "MB, 分段时长=" << segmentNs_ / 1000000000ULL << "s"
+            << (blackBoxSeconds_ > 0 ? ", 黑匣子模式保留最近" + std::to_string(blackBoxSeconds_) + "s" : "");
+    return true;
+}
+
+void PacketRecorder::stop()
+{
+    if (!helper_.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cond_.notify_one();
+    helper_.join();
+
+    // 后台线程已退出，收尾当前分段，未使用的就绪分段为空会被删除
+    if (current_ != nullptr)
+    {
+        closeSegment(current_);
+        current_ = nullptr;
+    }
+    Segment *unused = ready_.exchange(nullptr);
+    if (unused != nullptr)
+    {
+        closeSegment(unused);
+    }
+
+    LD_INFO << "原始数据包录制已停止: " << statsString();
+}
+
+void PacketRecorder::record(const uint8_t *data, size_t length, uint32_t sourceIp, uint64_t timeNs)
+{
+    if (current_ == nullptr)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const size_t need = RawRecord::recordBytes(length);
+    if (current_->used + need > current_->size)
+    {
+        // 当前分段已满，必须换到下一个分段
+        if (!rotate() || current_->used + need > current_->size)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    else if (currentStartNs_ != 0 && timeNs - currentStartNs_ >= segmentNs_)
+    {
+        // 分段到时，下一个分段未就绪时继续写当前分段
+        rotate();
+    }
+
+    Segment *segment = current_;
+    uint8_t *p = segment->base + segment->used;
+    const uint64_t offset = segment->used - headerBytes_;
+
+    RawRecord::RawRecordHeader record;
+    record.timeNs = timeNs;
+    record.sourceIp = sourceIp;
+    record.length = static_cast<uint16_t>(length);
+    record.reserved = 0;
+    memcpy(p, &record, sizeof(record));
+    memcpy(p + sizeof(record), data, length);
+
+    // 同一雷达出现新的帧ID时追加帧索引
+    if (length >= sizeof(FrameHeader))
+    {
+        const uint32_t frameId = ntohl(reinterpret_cast<const FrameHeader *>(data)->frameId);
+        int i = 0;
+        while (i < lastFrameCount_ && lastFrames_[i].sourceIp != sourceIp)
+        {
+            ++i;
+        }
+        if (i == lastFrameCount_ || lastFrames_[i].frameId != frameId)
+        {
+            addFrameIndex(segment, offset, timeNs, frameId, sourceIp);
+            if (i == lastFrameCount_ && lastFrameCount_ < LastFrameSlots)
+            {
+                lastFrameCount_++;
+            }
+            if (i < lastFrameCount_)
+            {
+                lastFrames_[i].sourceIp = sourceIp;
+                lastFrames_[i].frameId = frameId;
+            }
+        }
+    }
+
+    // 记录写完后再更新文件头，异常退出时文件头描述的记录都是完整的
+    segment->used += need;
+    RawRecord::RawSegmentHeader *h = header(segment);
+    if (h->recordCount == 0)
+    {
+        h->firstTimeNs = timeNs;
+        currentStartNs_ = timeNs;
+    }
+    h->lastTimeNs = timeNs;
+    h->dataBytes = segment->used - headerBytes_;
+    h->recordCount++;
+
+    records_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(length, std::memory_order_relaxed);
+}
+
+void PacketRecorder::addFrameIndex(Segment *segment, uint64_t offset, uint64_t timeNs, uint32_t frameId, uint32_t sourceIp)
+{
+    RawRecord::RawSegmentHeader *h = header(segment);
+    if (h->frameIndexCount >= h->frameIndexCapacity)
+    {
+        return;
+    }
+    RawRecord::RawFrameIndexEntry *entries =
+        reinterpret_cast<RawRecord::RawFrameIndexEntry *>(segment->base + sizeof(RawRecord::RawSegmentHeader));
+    RawRecord::RawFrameIndexEntry &entry = entries[h->frameIndexCount];
+    entry.offset = offset;
+    entry.timeNs = timeNs;
+    entry.frameId = frameId;
+    entry.sourceIp = sourceIp;
+    h->frameIndexCount++;
+}
+
+bool PacketRecorder::rotate()
+{
+    Segment *next = ready_.exchange(nullptr, std::memory_order_acq_rel);
+    if (next == nullptr)
+    {
+        return false;
+    }
+
+    Segment *old = current_;
+    current_ = next;
+    currentStartNs_ = 0;
+    lastFrameCount_ = 0;
+
+    // 旧分段交给后台线程收尾，并请求准备下一个分段
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired_.push_back(old);
+        needSegment_ = true;
+    }
+    cond_.notify_one();
+    return true;
+}
+
+void PacketRecorder::helperLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+        cond_.wait_for(lock, std::chrono::seconds(1),
+                       [this] { return stopping_ || needSegment_ || !retired_.empty(); });
+
+        std::deque<Segment *> retired;
+        retired.swap(retired_);
+        const bool need = needSegment_ && !stopping_;
+        const bool stop = stopping_;
+        lock.unlock();
+
+        for (size_t i = 0; i < retired.size(); ++i)
+        {
+            closeSegment(retired[i]);
+        }
+
+        bool created = true;
+        if (need)
+        {
+            Segment *segment = createSegment(nextSequence_);
+            if (segment != nullptr)
+            {
+                nextSequence_++;
+                ready_.store(segment, std::memory_order_release);
+            }
+            else
+            {
+                created = false;
+            }
+        }
+
+        lock.lock();
+        if (need)
+        {
+            // 创建失败时保留请求，下一轮（最多 1 秒后）重试
+            needSegment_ = !created;
+        }
+        if (stop && retired_.empty())
+        {
+            break;
+        }
+    }
+}
+
+PacketRecorder::Segment *PacketRecorder::createSegment(uint32_t sequence)
+{
+    std::ostringstream ss;
+    ss << directory_ << "/raw_" << sessionName_ << "_" << std::setw(6) << std::setfill('0') << sequence << ".ldraw";
+    const std::string path = ss.str();
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        LD_ERROR << "无法创建录制分段: " << path << ", 错误: " << strerror(errno);
+        return nullptr;
+    }
+
+    // 预先分配磁盘空间，避免写入映射内存时因磁盘满触发 SIGBUS
+    int err = posix_fallocate(fd, 0, segmentBytes_);
+    if (err != 0)
+    {
+        LD_ERROR << "录制分段预分配失败: " << path << ", 错误: " << strerror(err);
+        close(fd);
+        unlink(path.c_str());
+        return nullptr;
+    }
+
+    // 预先建立页表，接收线程写入时不产生缺页
+    void *mem = mmap(nullptr, segmentBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (mem == MAP_FAILED)
+    {
+        LD_ERROR << "录制分段映射失败: " << path << ", 错误: " << strerror(errno);
+        close(fd);
+        unlink(path.c_str());
+        return nullptr;
+    }
+
+    Segment *segment = new Segment();
+    segment->fd = fd;
+    segment->base = static_cast<uint8_t *>(mem);
+    segment->size = segmentBytes_;
+    segment->used = headerBytes_;
+    segment->sequence = sequence;
+    segment->path = path;
+
+    RawRecord::RawSegmentHeader *h = header(segment);
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, RawRecord::Magic, sizeof(h->magic));
+    h->version = RawRecord::Version;
+    h->headerBytes = static_cast<uint32_t>(headerBytes_);
+    h->segmentBytes = segmentBytes_;
+    h->sequence = sequence;
+    h->frameIndexCapacity = static_cast<uint32_t>(frameIndexCapacity_);
+    return segment;
+}
+
+void PacketRecorder::closeSegment(Segment *segment)
+{
+    const RawRecord::RawSegmentHeader *h = header(segment);
+    const uint32_t count = h->recordCount;
+    const uint64_t lastTimeNs = h->lastTimeNs;
+
+    munmap(segment->base, segment->size);
+
+    if (count == 0)
+    {
+        // 没有任何记录的分段直接删除
+        close(segment->fd);
+        unlink(segment->path.c_str());
+        delete segment;
+        return;
+    }
+
+    // 截断掉未使用的预分配空间
+    if (ftruncate(segment->fd, segment->used) != 0)
+    {
+        LD_WARN << "录制分段截断失败: " << segment->path << ", 错误: " << strerror(errno);
+    }
+    close(segment->fd);
+    segments_.fetch_add(1, std::memory_order_relaxed);
+    LD_DEBUG << "录制分段完成: " << segment->path << ", 记录数=" << count;
+
+    // 黑匣子模式：删除比最新分段早 blackBoxSeconds 以上的分段
+    if (blackBoxSeconds_ > 0)
+    {
+        closed_.push_back(std::make_pair(segment->path, lastTimeNs));
+        const uint64_t keepNs = static_cast<uint64_t>(blackBoxSeconds_) * 1000000000ULL;
+        while (closed_.size() > 1 && closed_.front().second + keepNs < lastTimeNs)
+        {
+            unlink(closed_.front().first.c_str());
+            closed_.pop_front();
+            deleted_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    delete segment;
+}
+
+std::string PacketRecorder::statsString() const
+{
+    std::ostringstream ss;
+    ss << "记录数=" << records_.load(std::memory_order_relaxed)
+       << ", 数据字节=" << bytes_.load(std::memory_order_relaxed)
+       << ", 丢弃=" << dropped_.load(std::memory_order_relaxed)
+       << ", 完成分段=" << segments_.load(std::memory_order_relaxed)
+       << ", 黑匣子删除分段=" << deleted_.load(std::memory_order_relaxed);
+    return ss.str();
+}
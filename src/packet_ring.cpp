@@ -0,0 +1,302 @@
+#include "packet_ring.h"
+#include "config.h"
+#include <cstring>
+#include <sstream>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+
+namespace {
+    // 等待解析线程归还块时的休眠时间
+    constexpr useconds_t HeldBackoffUs = 100;
+}
+
+PacketRing::PacketRing(int blockSize, int blockCount, int blockTimeoutMs)
+    : fd_(-1),
+      map_(nullptr),
+      blockSize_(blockSize),
+      blockCount_(blockCount),
+      blockTimeoutMs_(blockTimeoutMs),
+      current_(0),
+      oldest_(0),
+      held_(0),
+      refs_(new std::atomic<uint32_t>[blockCount])
+{
+    for (int i = 0; i < blockCount_; ++i)
+    {
+        refs_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+PacketRing::~PacketRing()
+{
+    close();
+}
+
+void PacketRing::close()
+{
+    if (map_ != nullptr)
+    {
+        munmap(map_, bufferBytes());
+        map_ = nullptr;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool PacketRing::open(const std::string &interface, int port)
+{
+    // SOCK_DGRAM：内核去掉链路层头部，帧从 IPv4 头部开始，以太网、VLAN 和回环接口的处理一致
+    fd_ = socket(AF_PACKET, SOCK_DGRAM, htons(ETH_P_IP));
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    // 只保留目的端口匹配、没有分片的 UDP 数据报，其余在内核中丢弃，不占用环形缓冲
+    // 过滤程序的偏移从 IPv4 头部开始
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 9),                          // 协议号
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 6),
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6),                          // 分片标志和偏移
+        BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x3FFF, 4, 0),
+        BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),                         // X = IPv4 头部长度
+        BPF_STMT(BPF_LD | BPF_H | BPF_IND, 2),                          // 目的端口
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<uint32_t>(port), 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, 0x40000),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    struct sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (setsockopt(fd_, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0)
+    {
+        close();
+        return false;
+    }
+
+    // 回环接口上发送的数据报也会以 PACKET_OUTGOING 出现一次，内核支持时直接忽略
+#ifdef PACKET_IGNORE_OUTGOING
+    int on = 1;
+    setsockopt(fd_, SOL_PACKET, PACKET_IGNORE_OUTGOING, &on, sizeof(on));
+#endif
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+    {
+        close();
+        return false;
+    }
+
+    // 块环形缓冲：块写满或 blockTimeoutMs 超时后交给用户态，超时限定了低速率时的延迟
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = static_cast<unsigned int>(blockSize_);
+    req.tp_block_nr = static_cast<unsigned int>(blockCount_);
+    req.tp_frame_size = TPACKET_ALIGNMENT << 7;
+    req.tp_frame_nr = req.tp_block_size / req.tp_frame_size * req.tp_block_nr;
+    req.tp_retire_blk_tov = static_cast<unsigned int>(blockTimeoutMs_);
+    if (setsockopt(fd_, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+    {
+        close();
+        return false;
+    }
+
+    void *map = mmap(nullptr, bufferBytes(), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd_, 0);
+    if (map == MAP_FAILED)
+    {
+        // 没有锁定内存的权限时退回普通映射
+        map = mmap(nullptr, bufferBytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    }
+    if (map == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+    map_ = static_cast<uint8_t *>(map);
+
+    // 最后绑定接口，绑定后内核才开始向环形缓冲写入
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_IP);
+    addr.sll_ifindex = static_cast<int>(if_nametoindex(interface.c_str()));
+    if (addr.sll_ifindex == 0 || bind(fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        int err = addr.sll_ifindex == 0 ? ENODEV : errno;
+        close();
+        errno = err;
+        return false;
+    }
+
+    return true;
+}
+
+bool PacketRing::joinMulticast(const std::string &interface, const char *group)
+{
+    struct in_addr addr;
+    if (inet_pton(AF_INET, group, &addr) != 1 || !IN_MULTICAST(ntohl(addr.s_addr)))
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    // IPv4 组播映射到 01:00:5e 加组地址的低 23 位
+    const uint32_t host = ntohl(addr.s_addr);
+    struct packet_mreq mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.mr_ifindex = static_cast<int>(if_nametoindex(interface.c_str()));
+    mreq.mr_type = PACKET_MR_MULTICAST;
+    mreq.mr_alen = ETH_ALEN;
+    mreq.mr_address[0] = 0x01;
+    mreq.mr_address[1] = 0x00;
+    mreq.mr_address[2] = 0x5e;
+    mreq.mr_address[3] = (host >> 16) & 0x7F;
+    mreq.mr_address[4] = (host >> 8) & 0xFF;
+    mreq.mr_address[5] = host & 0xFF;
+    return setsockopt(fd_, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == 0;
+}
+
+int PacketRing::nextBlock(int timeoutMs)
+{
+    packets_.clear();
+    releaseBlocks();
+
+    // 所有块都还被解析线程持有，内核此时只能丢包，等解析线程归还
+    if (held_ == blockCount_)
+    {
+        usleep(HeldBackoffUs);
+        return 0;
+    }
+
+    struct tpacket_block_desc *desc = reinterpret_cast<struct tpacket_block_desc *>(block(current_));
+    if ((__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+    {
+        struct pollfd pfd;
+        pfd.fd = fd_;
+        pfd.events = POLLIN | POLLERR;
+        pfd.revents = 0;
+        stats_.polls++;
+        int ready = poll(&pfd, 1, timeoutMs);
+        if (ready < 0)
+        {
+            return -1;
+        }
+        if ((__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+        {
+            // 内核以前一个块是否属于用户态判断可读，解析线程还持有该块时 poll 立即返回，短暂休眠避免空转
+            if (ready > 0)
+            {
+                usleep(HeldBackoffUs);
+            }
+            return 0;
+        }
+    }
+
+    // 逐个取出块中的 UDP 数据报，负载仍留在块中
+    const uint32_t count = desc->hdr.bh1.num_pkts;
+    const uint8_t *frame = block(current_) + desc->hdr.bh1.offset_to_first_pkt;
+    for (uint32_t n = 0; n < count; ++n)
+    {
+        const struct tpacket3_hdr *hdr = reinterpret_cast<const struct tpacket3_hdr *>(frame);
+        const struct sockaddr_ll *ll = reinterpret_cast<const struct sockaddr_ll *>(
+            frame + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+        const uint8_t *ip = frame + hdr->tp_net;
+        const uint32_t snaplen = hdr->tp_snaplen;
+        frame += hdr->tp_next_offset;
+
+        const uint32_t ihl = (ip[0] & 0x0F) * 4u;
+        if (ll->sll_pkttype == PACKET_OUTGOING || snaplen < ihl + 8 || ihl < 20)
+        {
+            stats_.skipped++;
+            continue;
+        }
+
+        uint32_t source = 0;
+        memcpy(&source, ip + 12, sizeof(source));
+        const uint32_t udpLength = (static_cast<uint32_t>(ip[ihl + 4]) << 8) | ip[ihl + 5];
+        if (udpLength < 8)
+        {
+            stats_.skipped++;
+            continue;
+        }
+
+        RingPacket packet;
+        packet.data = ip + ihl + 8;
+        packet.length = static_cast<uint16_t>(udpLength - 8);
+        packet.sourceAddr = ntohl(source);
+        packet.rxTimeNs = static_cast<uint64_t>(hdr->tp_sec) * 1000000000ULL + hdr->tp_nsec;
+        packet.truncated = hdr->tp_snaplen < hdr->tp_len || ihl + udpLength > snaplen;
+        packets_.push_back(packet);
+    }
+
+    stats_.blocks++;
+    stats_.packets += packets_.size();
+    current_ = (current_ + 1) % blockCount_;
+    held_++;
+    if (static_cast<uint32_t>(held_) > stats_.maxHeld)
+    {
+        stats_.maxHeld = static_cast<uint32_t>(held_);
+    }
+    return static_cast<int>(packets_.size());
+}
+
+std::atomic<uint32_t> *PacketRing::hold(int i)
+{
+    (void)i;
+    // 当前块是最近取出的块
+    std::atomic<uint32_t> *refs = &refs_[(current_ + blockCount_ - 1) % blockCount_];
+    refs->fetch_add(1, std::memory_order_relaxed);
+    return refs;
+}
+
+void PacketRing::releaseBlocks()
+{
+    while (held_ > 0 && refs_[oldest_].load(std::memory_order_acquire) == 0)
+    {
+        struct tpacket_block_desc *desc = reinterpret_cast<struct tpacket_block_desc *>(block(oldest_));
+        __atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        oldest_ = (oldest_ + 1) % blockCount_;
+        held_--;
+    }
+}
+
+uint64_t PacketRing::updateKernelStats()
+{
+    // 每次读取后内核计数清零，这里累加
+    struct tpacket_stats_v3 st;
+    socklen_t len = sizeof(st);
+    if (fd_ < 0 || getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &st, &len) != 0)
+    {
+        return 0;
+    }
+    stats_.kernelPackets += st.tp_packets;
+    stats_.kernelDrops += st.tp_drops;
+    stats_.freezes += st.tp_freeze_q_cnt;
+    return st.tp_drops;
+}
+
+std::string PacketRing::statsString() const
+{
+    std::ostringstream ss;
+    ss << "块大小=" << blockSize_ << "x" << blockCount_
+       << ", poll=" << stats_.polls
+       << ", 块=" << stats_.blocks
+       << ", 数据报=" << stats_.packets
+       << ", 跳过=" << stats_.skipped
+       << ", 最多持有块=" << stats_.maxHeld
+       << ", 内核抓包=" << stats_.kernelPackets
+       << ", 内核丢包=" << stats_.kernelDrops
+       << ", 队列冻结=" << stats_.freezes;
+    return ss.str();
+}
@@ -0,0 +1,301 @@
+#include "payload_decoder.h"
+#include "config.h"
+#include "logger.h"
+#include <cstring>
+#include <arpa/inet.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LD_DECODER_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LD_DECODER_SSE2 1
+#endif
+
+namespace {
+
+    bool g_scalarOnly = false;
+
+    // 坐标量化步长：x = X / 512（单位：米）。512 是 2 的幂，int16 换算在 float 中是精确的
+    const float CoordScale = 1.0f / 512.0f;
+
+    // 一行 5 列 * 3 回波 = 15 个点，向量实现按 16 个通道处理
+    const int RowPoints = PacketConfig::COLS_PER_PACKET * PacketConfig::EchoNumberOfPixel;
+    const int RowLanes = 16;
+
+    // 标量解码单个负载的全部回波，保持与原 processPacket 完全相同的运算顺序，返回有效点数
+    uint32_t decodePayloadScalar(const Payload &payload, FrameGrid &grid, size_t base, const float offset[3])
+    {
+        uint32_t validCount = 0;
+        const bool hasOffset = (offset[0] != 0.0f || offset[1] != 0.0f || offset[2] != 0.0f);
+        for (int echoId = 0; echoId < PacketConfig::EchoNumberOfPixel; ++echoId)
+        {
+            int16_t x = ntohs(payload.GetX(echoId));
+            int16_t y = ntohs(payload.GetY(echoId));
+            int16_t z = ntohs(payload.GetZ(echoId));
+
+            float x_f = static_cast<float>(x / 512.0);
+            float y_f = static_cast<float>(y / 512.0);
+            float z_f = static_cast<float>(z / 512.0);
+
+            if (hasOffset)
+            {
+                x_f += offset[0];
+                y_f += offset[1];
+                z_f += offset[2];
+            }
+
+            validCount += grid.set(base + echoId, x_f, y_f, z_f, payload.GetReflectivity(echoId));
+        }
+        return validCount;
+    }
+
+#if defined(LD_DECODER_NEON)
+    // 16 个大端 int16 -> 缩放并平移后的 float
+    inline void convertLanes(const int16_t *in, float *out, float offset)
+    {
+        const float32x4_t scale = vdupq_n_f32(CoordScale);
+        const float32x4_t off = vdupq_n_f32(offset);
+        for (int i = 0; i < RowLanes; i += 8)
+        {
+            int16x8_t v = vld1q_s16(in + i);
+            v = vreinterpretq_s16_u8(vrev16q_u8(vreinterpretq_u8_s16(v)));
+            float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+            float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+            vst1q_f32(out + i, vaddq_f32(vmulq_f32(lo, scale), off));
+            vst1q_f32(out + i + 4, vaddq_f32(vmulq_f32(hi, scale), off));
+        }
+    }
+#elif defined(LD_DECODER_SSE2)
+    inline void convertLanes(const int16_t *in, float *out, float offset)
+    {
+        const __m128 scale = _mm_set1_ps(CoordScale);
+        const __m128 off = _mm_set1_ps(offset);
+        for (int i = 0; i < RowLanes; i += 8)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            // 符号扩展到 int32：把 int16 放到高半部分再算术右移
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), scale), off));
+            _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), scale), off));
+        }
+    }
+#endif
+
+#if defined(LD_DECODER_NEON) || defined(LD_DECODER_SSE2)
+    // 向量实现：同一行的 5 个负载在帧网格中正好是连续的 15 个点，
+    // 先把各负载的 x/y/z 收集成连续的 int16 通道，再整行转换后写入
+    size_t decodePacketVector(const Gen2Packet *packet, FrameGrid &grid, const float offset[3])
+    {
+        const int subFrameId = packet->head.subFrameId;
+        const int startColId = packet->head.startColId;
+        const int colNum = (startColId == 255) ? 1 : PacketConfig::COLS_PER_PACKET;
+
+        // 列不足 5 或越界的包（最后一列、异常列号）退回标量路径
+        if (colNum != PacketConfig::COLS_PER_PACKET || startColId + colNum > grid.cols())
+        {
+            return PayloadDecoder::decodePacketScalar(packet, grid, offset);
+        }
+
+        alignas(16) int16_t sx[RowLanes];
+        alignas(16) int16_t sy[RowLanes];
+        alignas(16) int16_t sz[RowLanes];
+        alignas(16) float fx[RowLanes];
+        alignas(16) float fy[RowLanes];
+        alignas(16) float fz[RowLanes];
+        sx[RowLanes - 1] = sy[RowLanes - 1] = sz[RowLanes - 1] = 0;
+
+        const size_t echoBytes = sizeof(int16_t) * PacketConfig::EchoNumberOfPixel;
+        size_t written = 0;
+
+        for (int row = 0; row < PacketConfig::ROWS_PER_SUBFRAME; ++row)
+        {
+            const int curRow = subFrameId * PacketConfig::ROWS_PER_SUBFRAME + row;
+            if (curRow >= grid.rows())
+            {
+                continue;
+            }
+
+            const size_t base = grid.index(curRow, startColId, 0);
+            uint8_t *gi = grid.intensity() + base;
+
+            for (int col = 0; col < PacketConfig::COLS_PER_PACKET; ++col)
+            {
+                const Payload &payload = packet->payload[col * PacketConfig::ROWS_PER_SUBFRAME + row];
+                const int lane = col * PacketConfig::EchoNumberOfPixel;
+                memcpy(sx + lane, payload.x, echoBytes);
+                memcpy(sy + lane, payload.y, echoBytes);
+                memcpy(sz + lane, payload.z, echoBytes);
+                memcpy(gi + lane, payload.reflectivity, PacketConfig::EchoNumberOfPixel);
+            }
+
+            convertLanes(sx, fx, offset[0]);
+            convertLanes(sy, fy, offset[1]);
+            convertLanes(sz, fz, offset[2]);
+
+            memcpy(grid.x() + base, fx, sizeof(float) * RowPoints);
+            memcpy(grid.y() + base, fy, sizeof(float) * RowPoints);
+            memcpy(grid.z() + base, fz, sizeof(float) * RowPoints);
+
+            // 坐标全为零的点在解码时即标记为无效
+            uint8_t *gv = grid.valid() + base;
+            uint32_t rowValid = 0;
+            for (int i = 0; i < RowPoints; ++i)
+            {
+                const uint8_t v = (fx[i] != 0.0f) | (fy[i] != 0.0f) | (fz[i] != 0.0f);
+                gv[i] = v;
+                rowValid += v;
+            }
+            grid.addRowValid(curRow, rowValid);
+            written += RowPoints;
+        }
+        return written;
+    }
+
+    // 构造覆盖边界值的合成数据包，用于自检
+    void fillSyntheticPacket(Gen2Packet &packet, int subFrameId, int startColId, uint32_t seed)
+    {
+        memset(&packet, 0, sizeof(packet));
+        packet.head.subFrameId = static_cast<uint8_t>(subFrameId);
+        packet.head.startColId = static_cast<uint8_t>(startColId);
+
+        static const int16_t edges[] = {0, 1, -1, 32767, -32768, 512, -512, 12345};
+        const int edgeCount = sizeof(edges) / sizeof(edges[0]);
+        int n = 0;
+        for (int p = 0; p < 30; ++p)
+        {
+            Payload &payload = packet.payload[p];
+            for (int e = 0; e < PacketConfig::EchoNumberOfPixel; ++e, ++n)
+            {
+                seed = seed * 1103515245u + 12345u;
+                int16_t raw = (n < edgeCount) ? edges[n] : static_cast<int16_t>(seed >> 16);
+                payload.x[e] = htons(static_cast<uint16_t>(raw));
+                // 第一个点三个坐标全为零，覆盖解码时的零点剔除
+                payload.y[e] = htons(static_cast<uint16_t>(n == 0 ? 0 : raw ^ 0x5A5A));
+                payload.z[e] = htons(static_cast<uint16_t>(-raw));
+                payload.reflectivity[e] = static_cast<uint8_t>(seed >> 8);
+            }
+        }
+    }
+#endif
+}
+
+namespace PayloadDecoder {
+
+    Backend activeBackend()
+    {
+        if (g_scalarOnly)
+        {
+            return BACKEND_SCALAR;
+        }
+#if defined(LD_DECODER_NEON)
+        return BACKEND_NEON;
+#elif defined(LD_DECODER_SSE2)
+        return BACKEND_SSE2;
+#else
+        return BACKEND_SCALAR;
+#endif
+    }
+
+    const char *backendName(Backend backend)
+    {
+        switch (backend)
+        {
+            case BACKEND_NEON:  return "NEON";
+            case BACKEND_SSE2:  return "SSE2";
+            default:            return "scalar";
+        }
+    }
+
+    void setScalarOnly(bool scalarOnly)
+    {
+        g_scalarOnly = scalarOnly;
+    }
+
+    size_t decodePacketScalar(const Gen2Packet *packet, FrameGrid &grid, const float offset[3])
+    {
+        const int subFrameId = packet->head.subFrameId;
+        const int startColId = packet->head.startColId;
+        const int colNum = (startColId == 255) ? 1 : PacketConfig::COLS_PER_PACKET;
+        size_t written = 0;
+
+        for (int col = 0; col < colNum; ++col)
+        {
+            for (int row = 0; row < PacketConfig::ROWS_PER_SUBFRAME; ++row)
+            {
+                const int curRow = subFrameId * PacketConfig::ROWS_PER_SUBFRAME + row;
+                const int curCol = startColId + col;
+
+                // 确保不越界
+                if (curRow >= grid.rows() || curCol >= grid.cols())
+                {
+                    continue;
+                }
+
+                const Payload &payload = packet->payload[col * PacketConfig::ROWS_PER_SUBFRAME + row];
+                grid.addRowValid(curRow, decodePayloadScalar(payload, grid, grid.index(curRow, curCol, 0), offset));
+                written += PacketConfig::EchoNumberOfPixel;
+            }
+        }
+        return written;
+    }
+
+    size_t decodePacket(const Gen2Packet *packet, FrameGrid &grid, const float offset[3])
+    {
+#if defined(LD_DECODER_NEON) || defined(LD_DECODER_SSE2)
+        if (!g_scalarOnly)
+        {
+            return decodePacketVector(packet, grid, offset);
+        }
+#endif
+        return decodePacketScalar(packet, grid, offset);
+    }
+
+    bool selfCheck()
+    {
+#if defined(LD_DECODER_NEON) || defined(LD_DECODER_SSE2)
+        if (activeBackend() == BACKEND_SCALAR)
+        {
+            return true;
+        }
+
+        FrameGrid expected(PacketConfig::LD_LM_LIDAR_HEIGHT, PacketConfig::LD_LM_LIDAR_WIDTH,
+                           PacketConfig::EchoNumberOfPixel);
+        FrameGrid actual(PacketConfig::LD_LM_LIDAR_HEIGHT, PacketConfig::LD_LM_LIDAR_WIDTH,
+                         PacketConfig::EchoNumberOfPixel);
+
+        // 覆盖零平移和非零平移两种情况，以及首列、中间列和末尾列的数据包
+        static const float offsets[][3] = {{0.0f, 0.0f, 0.0f}, {0.1f, -2.5f, 1.75f}};
+        static const int columns[] = {0, 125, 250, 255};
+
+        Gen2Packet packet;
+        for (size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); ++o)
+        {
+            for (size_t c = 0; c < sizeof(columns) / sizeof(columns[0]); ++c)
+            {
+                int subFrameId = static_cast<int>((o * 7 + c * 11) % 32);
+                fillSyntheticPacket(packet, subFrameId, columns[c], static_cast<uint32_t>(o * 131 + c));
+                decodePacketScalar(&packet, expected, offsets[o]);
+                decodePacketVector(&packet, actual, offsets[o]);
+            }
+        }
+
+        const size_t n = expected.size();
+        bool same = memcmp(expected.x(), actual.x(), n * sizeof(float)) == 0 &&
+                    memcmp(expected.y(), actual.y(), n * sizeof(float)) == 0 &&
+                    memcmp(expected.z(), actual.z(), n * sizeof(float)) == 0 &&
+                    memcmp(expected.intensity(), actual.intensity(), n) == 0 &&
+                    memcmp(expected.valid(), actual.valid(), n) == 0 &&
+                    expected.validCount() == actual.validCount();
+        if (!same)
+        {
+            LD_ERROR << "解码内核自检失败: " << backendName(activeBackend()) << " 与标量实现结果不一致";
+        }
+        return same;
+#else
+        return true;
+#endif
+    }
+}
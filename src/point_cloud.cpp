@@ -8,13 +8,57 @@
 #include <iostream>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <cstring>
 #include <chrono>
 #include <config.h>
+#include "metrics.h"
+#include "thread_topology.h"
 
-PointCloudProcessor::PointCloudProcessor() : is_new_frame_(false) {}
+PointCloudProcessor::PointCloudProcessor()
+    : file_index_(0), is_new_frame_(false), save_format_(CLOUD_FORMAT_PLY_ASCII), last_write_bytes_(0),
+      saveQueue_(CloudConfig::save_queue_depth), saveHead_(0), saveCount_(0), saveStop_(false),
+      frameCount_(0), saved_(0), dropped_(0), writeTotalUs_(0), writeMaxUs_(0), writeLastUs_(0)
+{
+}
+
+PointCloudProcessor::~PointCloudProcessor()
+{
+    stop();
+}
 
-PointCloudProcessor::~PointCloudProcessor() {}
+void PointCloudProcessor::setSaveFormat(CloudFormat format)
+{
+    save_format_ = format;
+}
+
+void PointCloudProcessor::start()
+{
+    if (writerThread_.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(saveMutex_);
+        saveStop_ = false;
+    }
+    writerThread_ = std::thread(&PointCloudProcessor::writerLoop, this);
+}
+
+void PointCloudProcessor::stop()
+{
+    if (!writerThread_.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(saveMutex_);
+        saveStop_ = true;
+    }
+    saveCond_.notify_one();
+    writerThread_.join();
+}
 
 void PointCloudProcessor::setCallback(PointCloudCallback callback)
 {
@@ -23,23 +67,33 @@ void PointCloudProcessor::setCallback(PointCloudCallback callback)
 
 
 
-void PointCloudProcessor::processCloud(const PointCloud &cloud)
+void PointCloudProcessor::setSliceCallback(PointCloudSliceCallback callback)
 {
-    // 判断是否是完整的一帧点云
-    if (cloud.is_dense || (!cloud.points.empty() && cloud.width > 0))
+    sliceCallback_ = callback;
+}
+
+void PointCloudProcessor::processSlice(const PointCloudSlice &slice)
+{
+    LD_DEBUG << "子帧切片: 帧ID=" << slice.frame_id << ", 子帧=" << (int)slice.sub_frame_id
+             << ", 行[" << slice.row_begin << "," << slice.row_end << "), 点数=" << slice.points.size();
+
+    if (sliceCallback_)
     {
-        // 获取当前时间的年月日作为子目录
-        std::time_t now = std::time(nullptr);
-        std::tm *now_tm = std::localtime(&now);
+        sliceCallback_(slice);
+    }
+}
 
-        std::stringstream ss;
-        ss << CloudConfig::save_path << std::put_time(now_tm, "%Y%m%d");
-        std::string save_dir = ss.str();
+void PointCloudProcessor::processCloud(const PointCloudLease &lease)
+{
+    const PointCloud &cloud = *lease;
 
-        // 保存点云到文件
-        if (WriteCloud(cloud, save_dir))
+    // 判断是否是完整的一帧点云，按保存间隔每隔 N 帧保存一帧
+    if (CloudConfig::save_enabled && (cloud.is_dense || (!cloud.points.empty() && cloud.width > 0)))
+    {
+        const int interval = CloudConfig::save_interval > 0 ? CloudConfig::save_interval : 1;
+        if (frameCount_.fetch_add(1, std::memory_order_relaxed) % interval == 0)
         {
-            LD_INFO << "成功保存完整点云帧 ID: " << cloud.frame_id;
+            enqueueSave(lease);
         }
     }
 
@@ -50,6 +104,107 @@ void PointCloudProcessor::processCloud(const PointCloud &cloud)
     }
 }
 
+void PointCloudProcessor::enqueueSave(const PointCloudLease &lease)
+{
+    PointCloudLease droppedCloud;
+    {
+        std::lock_guard<std::mutex> lock(saveMutex_);
+        const size_t depth = saveQueue_.size();
+        if (depth == 0)
+        {
+            return;
+        }
+        if (saveCount_ == depth)
+        {
+            // 写盘跟不上：丢弃最旧的待保存帧，租约在锁外释放
+            droppedCloud = std::move(saveQueue_[saveHead_]);
+            saveHead_ = (saveHead_ + 1) % depth;
+            saveCount_--;
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        saveQueue_[(saveHead_ + saveCount_) % depth] = lease;
+        saveCount_++;
+    }
+    saveCond_.notify_one();
+
+    if (droppedCloud)
+    {
+        LD_WARN << "保存队列已满，丢弃待保存帧 ID: " << droppedCloud->frame_id;
+    }
+}
+
+void PointCloudProcessor::writerLoop()
+{
+    ThreadTopology::enterStage(ThreadTopology::STAGE_WRITER, "ld_writer");
+    LD_INFO << "点云保存线程启动";
+
+    for (;;)
+    {
+        PointCloudLease lease;
+        {
+            std::unique_lock<std::mutex> lock(saveMutex_);
+            saveCond_.wait(lock, [this] { return saveCount_ > 0 || saveStop_; });
+            if (saveCount_ == 0)
+            {
+                // 已请求停止且队列已写完
+                break;
+            }
+            lease = std::move(saveQueue_[saveHead_]);
+            saveHead_ = (saveHead_ + 1) % saveQueue_.size();
+            saveCount_--;
+        }
+
+        // 获取当前时间的年月日作为子目录（保存线程与其他线程并行，用可重入的 localtime_r）
+        std::time_t now = std::time(nullptr);
+        std::tm now_tm;
+        localtime_r(&now, &now_tm);
+
+        std::stringstream ss;
+        ss << CloudConfig::save_path << std::put_time(&now_tm, "%Y%m%d");
+        std::string save_dir = ss.str();
+
+        // 保存点云到文件
+        const auto t1 = std::chrono::steady_clock::now();
+        bool ok = WriteCloud(*lease, save_dir);
+        const auto t2 = std::chrono::steady_clock::now();
+
+        Metrics::cloudSave.observe(std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count());
+        const uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+        writeLastUs_.store(us, std::memory_order_relaxed);
+        writeTotalUs_.fetch_add(us, std::memory_order_relaxed);
+        if (us > writeMaxUs_.load(std::memory_order_relaxed))
+        {
+            writeMaxUs_.store(us, std::memory_order_relaxed);
+        }
+
+        if (ok)
+        {
+            saved_.fetch_add(1, std::memory_order_relaxed);
+            LD_INFO << "成功保存完整点云帧 ID: " << lease->frame_id;
+        }
+    }
+
+    LD_INFO << "点云保存线程退出";
+    ThreadTopology::leaveStage();
+}
+
+std::string PointCloudProcessor::saveStatsString() const
+{
+    const uint64_t saved = saved_.load(std::memory_order_relaxed);
+    const uint64_t total = writeTotalUs_.load(std::memory_order_relaxed);
+
+    std::ostringstream ss;
+    ss << "保存间隔=" << CloudConfig::save_interval
+       << ", 队列深度=" << saveQueue_.size()
+       << ", 已保存=" << saved
+       << ", 队满丢弃=" << dropped_.load(std::memory_order_relaxed)
+       << std::fixed << std::setprecision(1)
+       << ", 写盘耗时(ms) 最近=" << writeLastUs_.load(std::memory_order_relaxed) / 1000.0
+       << " 平均=" << (saved ? total / 1000.0 / saved : 0.0)
+       << " 最大=" << writeMaxUs_.load(std::memory_order_relaxed) / 1000.0;
+    return ss.str();
+}
+
 bool PointCloudProcessor::ensureDirectoryExists(const std::string &path)
 {
     struct stat info;
@@ -141,15 +296,39 @@ bool PointCloudProcessor::WriteCloud(const PointCloud &cloud, const std::string
 
     // 生成带时间戳的文件名
     std::time_t now = std::time(nullptr);
-    std::tm *now_tm = std::localtime(&now);
+    std::tm now_tm;
+    localtime_r(&now, &now_tm);
 
     std::stringstream ss;
     ss << directory << "/cloud_"
-       << std::put_time(now_tm, "%Y%m%d_%H%M%S")
-       << "_" << cloud.frame_id << ".ply";
+       << std::put_time(&now_tm, "%Y%m%d_%H%M%S")
+       << "_" << cloud.frame_id << (save_format_ == CLOUD_FORMAT_PCD_BINARY ? ".pcd" : ".ply");
 
     std::string filename = ss.str();
 
+    int valid_count = 0;
+    size_t bytes = 0;
+    bool ok = (save_format_ == CLOUD_FORMAT_PLY_ASCII)
+                  ? writeAscii(cloud, filename, valid_count, bytes)
+                  : writeBinary(cloud, filename, valid_count, bytes);
+    if (!ok)
+    {
+        return false;
+    }
+    last_write_bytes_ = bytes;
+
+    // 测量处理时间
+    const auto t2 = std::chrono::steady_clock::now();
+    const auto time_cost = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+    LD_INFO << "\n[SAVE]保存点云到: " << filename << ", 格式: " << cloudFormatName(save_format_)
+            << ", 有效点数: " << valid_count << ", 字节数: " << bytes
+            << ", 耗时: " << time_cost << " ms\n";
+
+    return true;
+}
+
+bool PointCloudProcessor::writeAscii(const PointCloud &cloud, const std::string &filename, int &valid_count, size_t &bytes)
+{
     // 打开文件并写入内容
     std::ofstream file(filename, std::ios::out);
     if (!file)
@@ -171,7 +350,7 @@ bool PointCloudProcessor::WriteCloud(const PointCloud &cloud, const std::string
     file << "end_header\n";
 
     // 写入点数据
-    int valid_count = 0;
+    valid_count = 0;
     for (const auto &point : cloud.points)
     {
         // 跳过无效点
@@ -185,13 +364,133 @@ bool PointCloudProcessor::WriteCloud(const PointCloud &cloud, const std::string
         valid_count++;
     }
 
+    bytes = static_cast<size_t>(file.tellp());
     file.close();
+    return true;
+}
 
-    // 测量处理时间
-    const auto t2 = std::chrono::steady_clock::now();
-    const auto time_cost = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
-    LD_INFO << "\n[SAVE]保存点云到: " << filename << ", 有效点数: " << valid_count
-            << ", 耗时: " << time_cost << " ms\n";
+size_t PointCloudProcessor::serializeBinary(const PointCloud &cloud, CloudFormat format, std::vector<char> &buffer)
+{
+    const size_t count = cloud.points.size();
+
+    // 文件头
+    char header[512];
+    int headerLen;
+    if (format == CLOUD_FORMAT_PCD_BINARY)
+    {
+        headerLen = snprintf(header, sizeof(header),
+                             "# .PCD v0.7 - Point Cloud Data file format\n"
+                             "VERSION 0.7\n"
+                             "FIELDS x y z intensity\n"
+                             "SIZE 4 4 4 1\n"
+                             "TYPE F F F U\n"
+                             "COUNT 1 1 1 1\n"
+                             "WIDTH %zu\n"
+                             "HEIGHT 1\n"
+                             "VIEWPOINT 0 0 0 1 0 0 0\n"
+                             "POINTS %zu\n"
+                             "DATA binary\n",
+                             count, count);
+    }
+    else
+    {
+        headerLen = snprintf(header, sizeof(header),
+                             "ply\n"
+                             "format binary_little_endian 1.0\n"
+                             "comment LDLidar point cloud\n"
+                             "comment Frame ID: %u\n"
+                             "element vertex %zu\n"
+                             "property float x\n"
+                             "property float y\n"
+                             "property float z\n"
+                             "property uchar intensity\n"
+                             "end_header\n",
+                             cloud.frame_id, count);
+    }
+
+    // 文件头和全部点数据放进同一块连续缓冲，缓冲在多次保存间复用
+    const size_t total = headerLen + count * BinaryPointSize;
+    if (buffer.size() < total)
+    {
+        buffer.resize(total);
+    }
+    char *out = buffer.data();
+    memcpy(out, header, headerLen);
+    out += headerLen;
+
+    // 每个点紧凑写成 x, y, z (float) + 强度 (uchar) 共 13 字节；
+    // RK3576 与 x86 均为小端，float 直接按内存表示写出即为 little endian
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Point3D &point = cloud.points[i];
+        memcpy(out, &point.x, sizeof(float) * 3);
+        out[sizeof(float) * 3] = static_cast<char>(point.intensity);
+        out += BinaryPointSize;
+    }
+    return total;
+}
+
+bool PointCloudProcessor::writeBinary(const PointCloud &cloud, const std::string &filename, int &valid_count, size_t &bytes)
+{
+    bytes = serializeBinary(cloud, save_format_, writeBuffer_);
+    valid_count = static_cast<int>(cloud.points.size());
+
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        LD_ERROR << "无法创建文件: " << filename << ", 错误: " << strerror(errno);
+        return false;
+    }
+
+    // 整个文件一次 write 写出，只在被信号打断或部分写入时继续
+    const char *data = writeBuffer_.data();
+    size_t remain = bytes;
+    while (remain > 0)
+    {
+        ssize_t n = write(fd, data, remain);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LD_ERROR << "写入文件失败: " << filename << ", 错误: " << strerror(errno);
+            close(fd);
+            return false;
+        }
+        data += n;
+        remain -= n;
+    }
 
+    if (close(fd) != 0)
+    {
+        LD_ERROR << "关闭文件失败: " << filename << ", 错误: " << strerror(errno);
+        return false;
+    }
     return true;
 }
+
+const char *PointCloudProcessor::cloudFormatName(CloudFormat format)
+{
+    switch (format)
+    {
+        case CLOUD_FORMAT_PLY_ASCII:  return "ply_ascii";
+        case CLOUD_FORMAT_PLY_BINARY: return "ply_binary";
+        case CLOUD_FORMAT_PCD_BINARY: return "pcd_binary";
+        default:                      return "unknown";
+    }
+}
+
+bool PointCloudProcessor::parseCloudFormat(const std::string &name, CloudFormat &format)
+{
+    static const CloudFormat formats[] = {CLOUD_FORMAT_PLY_ASCII, CLOUD_FORMAT_PLY_BINARY, CLOUD_FORMAT_PCD_BINARY};
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i)
+    {
+        if (name == cloudFormatName(formats[i]))
+        {
+            format = formats[i];
+            return true;
+        }
+    }
+    return false;
+}
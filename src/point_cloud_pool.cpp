@@ -0,0 +1,79 @@
+#include "point_cloud_pool.h"
+#include "logger.h"
+
+PointCloudPool::PointCloudPool(size_t count, size_t pointCapacity)
+    : pointCapacity_(pointCapacity), overflow_(0)
+{
+    // 空闲列表按最终可能的规模预留，归还时不会触发扩容
+    entries_.reserve(count);
+    free_.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        free_.push_back(createEntry());
+    }
+
+    LD_DEBUG << "点云池初始化: " << count << " 个缓冲, 每个预留 " << pointCapacity << " 个点";
+}
+
+PointCloudPool::~PointCloudPool()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.size() != entries_.size())
+    {
+        LD_WARN << "点云池销毁时仍有 " << entries_.size() - free_.size() << " 个缓冲未归还";
+    }
+}
+
+PooledPointCloud *PointCloudPool::createEntry()
+{
+    std::unique_ptr<PooledPointCloud> entry(new PooledPointCloud());
+    entry->pool = this;
+    entry->cloud.points.reserve(pointCapacity_);
+    entries_.push_back(std::move(entry));
+    return entries_.back().get();
+}
+
+PointCloudLease PointCloudPool::acquire()
+{
+    PooledPointCloud *entry = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty())
+        {
+            entry = free_.back();
+            free_.pop_back();
+        }
+        else
+        {
+            // 所有缓冲都被下游持有：额外分配一个，之后它也留在池中
+            entry = createEntry();
+            free_.reserve(entries_.size());
+            overflow_.fetch_add(1, std::memory_order_relaxed);
+            LD_WARN << "点云池已空，额外分配缓冲，当前总数: " << entries_.size();
+        }
+    }
+
+    entry->refs.store(1, std::memory_order_relaxed);
+    return PointCloudLease(entry);
+}
+
+void PointCloudPool::recycle(PooledPointCloud *entry)
+{
+    // 只清空点，保留已分配的容量
+    entry->cloud.clear();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(entry);
+}
+
+size_t PointCloudPool::capacity()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+size_t PointCloudPool::available()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_.size();
+}
@@ -0,0 +1,387 @@
+#include "replay_source.h"
+#include "raw_record_format.h"
+#include "logger.h"
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+
+namespace {
+    // pcap 文件头魔数（按文件中的字节序读出）
+    constexpr uint32_t PcapMagicMicro = 0xa1b2c3d4;
+    constexpr uint32_t PcapMagicNano = 0xa1b23c4d;
+    constexpr uint32_t PcapMagicMicroSwapped = 0xd4c3b2a1;
+    constexpr uint32_t PcapMagicNanoSwapped = 0x4d3cb2a1;
+    constexpr size_t PcapFileHeaderBytes = 24;
+    constexpr size_t PcapRecordHeaderBytes = 16;
+
+    // 支持的链路类型
+    constexpr uint32_t LinkEthernet = 1;
+    constexpr uint32_t LinkRawIp = 101;
+    constexpr uint32_t LinkRawIpAlt = 12;   // 部分系统上 DLT_RAW 的取值
+    constexpr uint32_t LinkLinuxSll = 113;
+    constexpr uint32_t LinkLinuxSll2 = 276;
+
+    constexpr uint16_t EtherTypeIpv4 = 0x0800;
+    constexpr uint16_t EtherTypeVlan = 0x8100;
+    constexpr uint16_t EtherTypeQinQ = 0x88a8;
+
+    inline uint16_t readBe16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    inline uint32_t readBe32(const uint8_t* p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    inline uint32_t readLe32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+}
+
+ReplaySource::ReplaySource(int port)
+    : port_(port), fileIndex_(0), fd_(-1), base_(nullptr), size_(0), offset_(0), end_(0),
+      pcapSwapped_(false), pcapNano_(false), linkType_(0), packets_(0), skipped_(0)
+{
+}
+
+ReplaySource::~ReplaySource()
+{
+    unmapFile();
+}
+
+bool ReplaySource::probe(const std::string &path, FileKind &kind)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        LD_ERROR << "无法打开回放文件 " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    uint8_t head[sizeof(RawRecord::Magic)];
+    ssize_t n = ::read(fd, head, sizeof(head));
+    ::close(fd);
+    if (n != static_cast<ssize_t>(sizeof(head)))
+    {
+        LD_ERROR << "回放文件过短: " << path;
+        return false;
+    }
+
+    if (memcmp(head, RawRecord::Magic, sizeof(RawRecord::Magic)) == 0)
+    {
+        kind = KIND_RAW;
+        return true;
+    }
+
+    const uint32_t magic = readLe32(head);
+    if (magic == PcapMagicMicro || magic == PcapMagicNano ||
+        magic == PcapMagicMicroSwapped || magic == PcapMagicNanoSwapped)
+    {
+        kind = KIND_PCAP;
+        return true;
+    }
+
+    LD_ERROR << "无法识别的回放文件格式（只支持 .ldraw 分段和经典 pcap）: " << path;
+    return false;
+}
+
+bool ReplaySource::open(const std::vector<std::string> &paths)
+{
+    unmapFile();
+    paths_.clear();
+    kinds_.clear();
+    fileIndex_ = 0;
+
+    for (const auto &path : paths)
+    {
+        FileKind kind;
+        if (!probe(path, kind))
+        {
+            return false;
+        }
+        paths_.push_back(path);
+        kinds_.push_back(kind);
+    }
+    return !paths_.empty();
+}
+
+bool ReplaySource::mapFile(size_t index)
+{
+    const std::string &path = paths_[index];
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+    {
+        LD_ERROR << "无法打开回放文件 " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size <= 0)
+    {
+        LD_ERROR << "回放文件为空: " << path;
+        unmapFile();
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+
+    void *addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (addr == MAP_FAILED)
+    {
+        LD_ERROR << "映射回放文件失败 " << path << ": " << strerror(errno);
+        size_ = 0;
+        unmapFile();
+        return false;
+    }
+    base_ = static_cast<const uint8_t *>(addr);
+    // 顺序读取，让内核加大预读
+    madvise(addr, size_, MADV_SEQUENTIAL);
+
+    if (kinds_[index] == KIND_RAW)
+    {
+        RawRecord::RawSegmentHeader header;
+        if (size_ < sizeof(header))
+        {
+            LD_ERROR << "分段文件头不完整: " << path;
+            unmapFile();
+            return false;
+        }
+        memcpy(&header, base_, sizeof(header));
+        if (header.version != RawRecord::Version || header.headerBytes > size_)
+        {
+            LD_ERROR << "分段文件版本或文件头不匹配: " << path;
+            unmapFile();
+            return false;
+        }
+        // 只读到文件头记录的已写入位置，预分配但未使用的部分全是0
+        offset_ = header.headerBytes;
+        end_ = header.headerBytes + header.dataBytes;
+        if (end_ > size_)
+        {
+            end_ = size_;
+        }
+        LD_INFO << "回放分段 " << path << ": 记录数=" << header.recordCount
+                << ", 时长=" << (header.lastTimeNs - header.firstTimeNs) / 1000000 << "ms";
+    }
+    else
+    {
+        if (size_ < PcapFileHeaderBytes)
+        {
+            LD_ERROR << "pcap 文件头不完整: " << path;
+            unmapFile();
+            return false;
+        }
+        const uint32_t magic = readLe32(base_);
+        pcapSwapped_ = (magic == PcapMagicMicroSwapped || magic == PcapMagicNanoSwapped);
+        pcapNano_ = (magic == PcapMagicNano || magic == PcapMagicNanoSwapped);
+        linkType_ = pcap32(base_ + 20) & 0xFFFF;
+        if (linkType_ != LinkEthernet && linkType_ != LinkRawIp && linkType_ != LinkRawIpAlt &&
+            linkType_ != LinkLinuxSll && linkType_ != LinkLinuxSll2)
+        {
+            LD_ERROR << "不支持的 pcap 链路类型 " << linkType_ << ": " << path;
+            unmapFile();
+            return false;
+        }
+        offset_ = PcapFileHeaderBytes;
+        end_ = size_;
+        LD_INFO << "回放 pcap " << path << ": 链路类型=" << linkType_
+                << ", 时间精度=" << (pcapNano_ ? "ns" : "us") << ", 端口=" << port_;
+    }
+    return true;
+}
+
+void ReplaySource::unmapFile()
+{
+    if (base_ != nullptr)
+    {
+        munmap(const_cast<uint8_t *>(base_), size_);
+        base_ = nullptr;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+    offset_ = 0;
+    end_ = 0;
+}
+
+bool ReplaySource::next(ReplayPacket &packet)
+{
+    while (fileIndex_ < paths_.size())
+    {
+        if (base_ == nullptr && !mapFile(fileIndex_))
+        {
+            // 无法读取的文件跳过，继续回放后面的文件
+            ++fileIndex_;
+            continue;
+        }
+
+        bool ok = kinds_[fileIndex_] == KIND_RAW ? nextRaw(packet) : nextPcap(packet);
+        if (ok)
+        {
+            ++packets_;
+            return true;
+        }
+
+        unmapFile();
+        ++fileIndex_;
+    }
+    return false;
+}
+
+bool ReplaySource::nextRaw(ReplayPacket &packet)
+{
+    if (offset_ + sizeof(RawRecord::RawRecordHeader) > end_)
+    {
+        return false;
+    }
+
+    RawRecord::RawRecordHeader header;
+    memcpy(&header, base_ + offset_, sizeof(header));
+    const size_t bytes = RawRecord::recordBytes(header.length);
+    if (header.length == 0 || offset_ + sizeof(header) + header.length > end_)
+    {
+        // 记录头损坏，放弃本分段剩余部分
+        LD_WARN << "分段 " << paths_[fileIndex_] << " 在偏移 " << offset_ << " 处记录损坏，跳过剩余部分";
+        return false;
+    }
+
+    packet.data = base_ + offset_ + sizeof(header);
+    packet.length = header.length;
+    packet.sourceIp = header.sourceIp;
+    packet.timeNs = header.timeNs;
+    offset_ += bytes;
+    return true;
+}
+
+bool ReplaySource::nextPcap(ReplayPacket &packet)
+{
+    while (offset_ + PcapRecordHeaderBytes <= end_)
+    {
+        const uint8_t *rec = base_ + offset_;
+        const uint32_t sec = pcap32(rec);
+        const uint32_t frac = pcap32(rec + 4);
+        const uint32_t inclLen = pcap32(rec + 8);
+        const uint32_t origLen = pcap32(rec + 12);
+
+        if (offset_ + PcapRecordHeaderBytes + inclLen > end_)
+        {
+            // 抓包在写入中途结束
+            LD_WARN << "pcap " << paths_[fileIndex_] << " 最后一条记录不完整";
+            return false;
+        }
+        offset_ += PcapRecordHeaderBytes + inclLen;
+
+        if (inclLen < origLen)
+        {
+            // 抓包长度限制导致截断，数据不完整
+            ++skipped_;
+            continue;
+        }
+        if (!extractUdp(rec + PcapRecordHeaderBytes, inclLen, packet))
+        {
+            ++skipped_;
+            continue;
+        }
+        packet.timeNs = static_cast<uint64_t>(sec) * 1000000000ULL +
+                        (pcapNano_ ? frac : static_cast<uint64_t>(frac) * 1000ULL);
+        return true;
+    }
+    return false;
+}
+
+bool ReplaySource::extractUdp(const uint8_t *frame, size_t length, ReplayPacket &packet) const
+{
+    // 跳过链路层头，得到以太类型和IP头位置
+    size_t ipOffset = 0;
+    uint16_t etherType = EtherTypeIpv4;
+    switch (linkType_)
+    {
+    case LinkEthernet:
+        if (length < 14)
+        {
+            return false;
+        }
+        etherType = readBe16(frame + 12);
+        ipOffset = 14;
+        while ((etherType == EtherTypeVlan || etherType == EtherTypeQinQ) && ipOffset + 4 <= length)
+        {
+            etherType = readBe16(frame + ipOffset + 2);
+            ipOffset += 4;
+        }
+        break;
+    case LinkLinuxSll:
+        if (length < 16)
+        {
+            return false;
+        }
+        etherType = readBe16(frame + 14);
+        ipOffset = 16;
+        break;
+    case LinkLinuxSll2:
+        if (length < 20)
+        {
+            return false;
+        }
+        etherType = readBe16(frame);
+        ipOffset = 20;
+        break;
+    default:
+        break;
+    }
+    if (etherType != EtherTypeIpv4 || ipOffset + 20 > length)
+    {
+        return false;
+    }
+
+    // IPv4 头
+    const uint8_t *ip = frame + ipOffset;
+    const size_t ipHeaderBytes = (ip[0] & 0x0F) * 4;
+    if ((ip[0] >> 4) != 4 || ipHeaderBytes < 20 || ip[9] != IPPROTO_UDP)
+    {
+        return false;
+    }
+    // 分片（MF 置位或片偏移非0）无法单独解析
+    if ((readBe16(ip + 6) & 0x3FFF) != 0)
+    {
+        return false;
+    }
+    size_t ipTotal = readBe16(ip + 2);
+    if (ipTotal < ipHeaderBytes + 8 || ipOffset + ipTotal > length)
+    {
+        return false;
+    }
+
+    // UDP 头
+    const uint8_t *udp = ip + ipHeaderBytes;
+    if (readBe16(udp + 2) != port_)
+    {
+        return false;
+    }
+    const size_t udpLength = readBe16(udp + 4);
+    if (udpLength < 8 || ipHeaderBytes + udpLength > ipTotal)
+    {
+        return false;
+    }
+
+    packet.data = udp + 8;
+    packet.length = udpLength - 8;
+    packet.sourceIp = readBe32(ip + 12);
+    return true;
+}
+
+uint32_t ReplaySource::pcap32(const uint8_t *p) const
+{
+    const uint32_t v = readLe32(p);
+    return pcapSwapped_ ? __builtin_bswap32(v) : v;
+}
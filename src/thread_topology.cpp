@@ -0,0 +1,376 @@
+#include "thread_topology.h"
+#include "config.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <sstream>
+
+namespace {
+
+    // 登记的流水线线程
+    struct ThreadRecord {
+        pid_t tid;
+        std::string name;
+        ThreadTopology::Stage stage;
+        bool active;            // 线程是否仍在运行，退出后只保留最终迁移次数
+        int64_t migrations;     // 最近读到的迁移次数，-1 表示内核未提供
+    };
+
+    std::mutex g_mutex;
+    std::vector<ThreadRecord> g_threads;
+    thread_local int t_recordIndex = -1;
+
+    // 读取 /proc/self/task/<tid>/sched 中的 se.nr_migrations，需要内核开启 CONFIG_SCHED_DEBUG
+    int64_t readMigrations(pid_t tid)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/self/task/%d/sched", static_cast<int>(tid));
+        FILE *fp = fopen(path, "r");
+        if (fp == nullptr)
+        {
+            return -1;
+        }
+
+        int64_t migrations = -1;
+        char line[256];
+        while (fgets(line, sizeof(line), fp) != nullptr)
+        {
+            if (strncmp(line, "se.nr_migrations", 16) == 0)
+            {
+                const char *colon = strchr(line, ':');
+                if (colon != nullptr)
+                {
+                    migrations = strtoll(colon + 1, nullptr, 10);
+                }
+                break;
+            }
+        }
+        fclose(fp);
+        return migrations;
+    }
+
+    // 读取 CPU 的相对性能：优先 cpu_capacity（arm64 的 DT 配置），其次最高频率，都没有时为0
+    long readCpuCapacity(int cpu)
+    {
+        static const char *const files[] = {"cpu_capacity", "cpufreq/cpuinfo_max_freq"};
+        for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); ++i)
+        {
+            char path[96];
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, files[i]);
+            FILE *fp = fopen(path, "r");
+            if (fp == nullptr)
+            {
+                continue;
+            }
+            long value = 0;
+            int n = fscanf(fp, "%ld", &value);
+            fclose(fp);
+            if (n == 1)
+            {
+                return value;
+            }
+        }
+        return 0;
+    }
+
+    // 按性能划分大核和小核；同构处理器上两者都是全部 CPU
+    void clusterCpus(bool big, cpu_set_t &set)
+    {
+        const int count = static_cast<int>(sysconf(_SC_NPROCESSORS_CONF));
+        std::vector<long> capacity(count > 0 ? count : 0);
+        long highest = 0;
+        for (int cpu = 0; cpu < count; ++cpu)
+        {
+            capacity[cpu] = readCpuCapacity(cpu);
+            highest = std::max(highest, capacity[cpu]);
+        }
+
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < count; ++cpu)
+        {
+            if ((capacity[cpu] == highest) == big)
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+        if (CPU_COUNT(&set) == 0)
+        {
+            for (int cpu = 0; cpu < count; ++cpu)
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+    }
+
+    const std::string &stageCpus(ThreadTopology::Stage stage)
+    {
+        switch (stage)
+        {
+        case ThreadTopology::STAGE_RECEIVE: return ThreadConfig::receive_cpus;
+        case ThreadTopology::STAGE_PARSE:   return ThreadConfig::parse_cpus;
+        case ThreadTopology::STAGE_WRITER:  return ThreadConfig::writer_cpus;
+        default:                            return ThreadConfig::logger_cpus;
+        }
+    }
+
+    int stagePriority(ThreadTopology::Stage stage)
+    {
+        switch (stage)
+        {
+        case ThreadTopology::STAGE_RECEIVE: return ThreadConfig::ReceivePriority;
+        case ThreadTopology::STAGE_PARSE:   return ThreadConfig::ParsePriority;
+        default:                            return 0;
+        }
+    }
+
+    std::string policyString()
+    {
+        int policy = 0;
+        struct sched_param param;
+        if (pthread_getschedparam(pthread_self(), &policy, &param) != 0)
+        {
+            return "未知";
+        }
+        std::ostringstream ss;
+        switch (policy)
+        {
+        case SCHED_FIFO:  ss << "SCHED_FIFO/" << param.sched_priority; break;
+        case SCHED_RR:    ss << "SCHED_RR/" << param.sched_priority; break;
+        case SCHED_OTHER: ss << "SCHED_OTHER"; break;
+        default:          ss << "策略" << policy; break;
+        }
+        return ss.str();
+    }
+}
+
+namespace ThreadTopology {
+
+const char *stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case STAGE_RECEIVE: return "receive";
+    case STAGE_PARSE:   return "parse";
+    case STAGE_WRITER:  return "writer";
+    case STAGE_LOGGER:  return "logger";
+    default:            return "unknown";
+    }
+}
+
+bool parseCpuList(const std::string &spec, cpu_set_t &set)
+{
+    CPU_ZERO(&set);
+    if (spec.empty())
+    {
+        return false;
+    }
+    if (spec == "big" || spec == "little")
+    {
+        clusterCpus(spec == "big", set);
+        return true;
+    }
+    if (spec == "all")
+    {
+        const int count = static_cast<int>(sysconf(_SC_NPROCESSORS_CONF));
+        for (int cpu = 0; cpu < count; ++cpu)
+        {
+            CPU_SET(cpu, &set);
+        }
+        return true;
+    }
+
+    // "0-3,6" 形式的列表
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        int first = 0;
+        int last = 0;
+        if (sscanf(item.c_str(), "%d-%d", &first, &last) == 2)
+        {
+        }
+        else if (sscanf(item.c_str(), "%d", &first) == 1)
+        {
+            last = first;
+        }
+        else
+        {
+            LD_WARN << "无法解析的 CPU 列表: " << spec;
+            CPU_ZERO(&set);
+            return false;
+        }
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (cpu >= 0)
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+    }
+    return CPU_COUNT(&set) > 0;
+}
+
+std::string cpuListString(const cpu_set_t &set)
+{
+    std::ostringstream ss;
+    bool first = true;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (!CPU_ISSET(cpu, &set))
+        {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set))
+        {
+            ++last;
+        }
+        ss << (first ? "" : ",") << cpu;
+        if (last > cpu)
+        {
+            ss << "-" << last;
+        }
+        first = false;
+        cpu = last;
+    }
+    return ss.str();
+}
+
+void enterStage(Stage stage, const std::string &name)
+{
+    // 线程名最长 15 个字符，便于在 top -H / perf 中区分各阶段
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+    const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+
+    cpu_set_t wanted;
+    if (parseCpuList(stageCpus(stage), wanted) && sched_setaffinity(0, sizeof(wanted), &wanted) != 0)
+    {
+        LD_WARN << "线程 " << name << " 绑定 CPU " << cpuListString(wanted) << " 失败: " << strerror(errno);
+    }
+
+    const int priority = stagePriority(stage);
+    if (priority > 0)
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0)
+        {
+            LD_WARN << "线程 " << name << " 设置 SCHED_FIFO/" << priority << " 失败: " << strerror(err);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        ThreadRecord record;
+        record.tid = tid;
+        record.name = name;
+        record.stage = stage;
+        record.active = true;
+        record.migrations = readMigrations(tid);
+        t_recordIndex = static_cast<int>(g_threads.size());
+        g_threads.push_back(record);
+    }
+
+    // 输出实际生效的布局
+    cpu_set_t effective;
+    CPU_ZERO(&effective);
+    sched_getaffinity(0, sizeof(effective), &effective);
+    LD_INFO << "线程 " << name << " (tid " << tid << ", " << stageName(stage) << "): CPU "
+            << cpuListString(effective) << ", 调度 " << policyString() << ", 当前在 CPU " << sched_getcpu();
+}
+
+void leaveStage()
+{
+    if (t_recordIndex < 0)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    ThreadRecord &record = g_threads[t_recordIndex];
+    record.migrations = readMigrations(record.tid);
+    record.active = false;
+    t_recordIndex = -1;
+}
+
+bool lockMemory()
+{
+    if (!ThreadConfig::lock_memory)
+    {
+        return true;
+    }
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        LD_WARN << "mlockall 失败: " << strerror(errno) << "（需要 CAP_IPC_LOCK 或足够的 RLIMIT_MEMLOCK）";
+        return false;
+    }
+    LD_INFO << "已锁定进程内存 (mlockall)";
+    return true;
+}
+
+uint64_t stageMigrations(Stage stage)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    uint64_t total = 0;
+    for (size_t i = 0; i < g_threads.size(); ++i)
+    {
+        ThreadRecord &record = g_threads[i];
+        if (record.stage != stage)
+        {
+            continue;
+        }
+        if (record.active)
+        {
+            int64_t now = readMigrations(record.tid);
+            if (now >= 0)
+            {
+                record.migrations = now;
+            }
+        }
+        if (record.migrations > 0)
+        {
+            total += static_cast<uint64_t>(record.migrations);
+        }
+    }
+    return total;
+}
+
+std::string report()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::ostringstream ss;
+    for (size_t i = 0; i < g_threads.size(); ++i)
+    {
+        ThreadRecord &record = g_threads[i];
+        if (record.active)
+        {
+            int64_t now = readMigrations(record.tid);
+            if (now >= 0)
+            {
+                record.migrations = now;
+            }
+        }
+        ss << (i ? "; " : "") << record.name << "(" << stageName(record.stage) << ") 迁移=";
+        if (record.migrations >= 0)
+        {
+            ss << record.migrations;
+        }
+        else
+        {
+            ss << "不可用";
+        }
+    }
+    return ss.str();
+}
+
+}
@@ -0,0 +1,287 @@
+#include "udp_receiver.h"
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <errno.h>
+#include <linux/filter.h>
+#include <time.h>
+#include "metrics.h"
+
+bool attachReusePortDispatch(int fd, int shardCount)
+{
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+    // 程序运行时数据指针位于 UDP 负载，来源IP用相对网络层头部的偏移读取（IPv4 头部第 12 字节）
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_NET_OFF) + 12),
+        BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xFF),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<uint32_t>(shardCount)),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+    struct sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
+#else
+    (void)fd;
+    (void)shardCount;
+    errno = ENOPROTOOPT;
+    return false;
+#endif
+}
+
+UdpReceiver::UdpReceiver(PacketPool &pool, int batchSize)
+    : pool_(pool),
+      batchSize_(batchSize > 0 ? batchSize : 1),
+      handles_(batchSize_, InvalidPacketHandle),
+      spare_(batchSize_),
+      msgs_(batchSize_),
+      iovecs_(batchSize_),
+      addrs_(batchSize_),
+      controls_(batchSize_),
+      rxTimes_(batchSize_, 0),
+      timestamps_(false),
+      dropCounter_(false),
+      lastCount_(0)
+{
+    stats_.fillHistogram.resize(batchSize_ + 1, 0);
+
+    for (int i = 0; i < batchSize_; ++i)
+    {
+        iovecs_[i].iov_base = discardSlot_.data;
+        iovecs_[i].iov_len = sizeof(discardSlot_.data);
+
+        memset(&msgs_[i], 0, sizeof(msgs_[i]));
+        msgs_[i].msg_hdr.msg_iov = &iovecs_[i];
+        msgs_[i].msg_hdr.msg_iovlen = 1;
+        msgs_[i].msg_hdr.msg_name = &addrs_[i];
+        msgs_[i].msg_hdr.msg_namelen = sizeof(addrs_[i]);
+    }
+}
+
+void UdpReceiver::takeArmedHandles(std::vector<PacketHandle> &out)
+{
+    for (int i = 0; i < batchSize_; ++i)
+    {
+        if (handles_[i] != InvalidPacketHandle)
+        {
+            out.push_back(handles_[i]);
+            handles_[i] = InvalidPacketHandle;
+            iovecs_[i].iov_base = discardSlot_.data;
+        }
+    }
+}
+
+bool UdpReceiver::enableTimestamps(int fd)
+{
+    int on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0)
+    {
+        return false;
+    }
+
+    timestamps_ = true;
+    attachControls();
+    return true;
+}
+
+bool UdpReceiver::enableDropCounter(int fd)
+{
+    int on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) < 0)
+    {
+        return false;
+    }
+
+    dropCounter_ = true;
+    attachControls();
+    return true;
+}
+
+void UdpReceiver::attachControls()
+{
+    for (int i = 0; i < batchSize_; ++i)
+    {
+        msgs_[i].msg_hdr.msg_control = controls_[i].data;
+        msgs_[i].msg_hdr.msg_controllen = sizeof(controls_[i].data);
+    }
+}
+
+void UdpReceiver::resetHeaders(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        msgs_[i].msg_hdr.msg_namelen = sizeof(addrs_[i]);
+        if (timestamps_ || dropCounter_)
+        {
+            msgs_[i].msg_hdr.msg_controllen = sizeof(controls_[i].data);
+        }
+        msgs_[i].msg_hdr.msg_flags = 0;
+        msgs_[i].msg_len = 0;
+    }
+}
+
+int UdpReceiver::armSlots()
+{
+    // 已挂接槽位的消息头保持不变，只为被取走的位置重新申请
+    size_t need = 0;
+    for (int i = 0; i < batchSize_; ++i)
+    {
+        if (handles_[i] == InvalidPacketHandle)
+        {
+            ++need;
+        }
+    }
+    size_t got = need ? pool_.acquireBulk(spare_.data(), need) : 0;
+
+    // 池不足时，本次只接收到第一个仍缺槽位的位置之前
+    int armed = batchSize_;
+    size_t next = 0;
+    for (int i = 0; i < batchSize_; ++i)
+    {
+        if (handles_[i] != InvalidPacketHandle)
+        {
+            continue;
+        }
+        if (next < got)
+        {
+            handles_[i] = spare_[next++];
+            iovecs_[i].iov_base = pool_.slot(handles_[i]).data;
+        }
+        else if (armed == batchSize_)
+        {
+            armed = i;
+        }
+    }
+
+    if (armed == 0)
+    {
+        // 池已耗尽：仍然接收到丢弃槽位，避免内核缓冲区积压
+        iovecs_[0].iov_base = discardSlot_.data;
+        stats_.poolExhausted++;
+        return 1;
+    }
+    return armed;
+}
+
+int UdpReceiver::receiveBatch(int fd)
+{
+    // 恢复上一批被内核修改过的消息头
+    resetHeaders(lastCount_);
+    lastCount_ = 0;
+
+    int armed = armSlots();
+
+    // MSG_WAITFORONE：阻塞到第一个数据报到达，之后只取已排队的数据报
+    int n = recvmmsg(fd, msgs_.data(), armed, MSG_WAITFORONE, nullptr);
+    stats_.syscalls++;
+
+    if (n <= 0)
+    {
+        return n;
+    }
+
+    stats_.batches++;
+    stats_.packets += n;
+    stats_.fillHistogram[n]++;
+    if (n == batchSize_)
+    {
+        stats_.fullBatches++;
+    }
+    if (static_cast<uint32_t>(n) > stats_.maxFill)
+    {
+        stats_.maxFill = n;
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        if (packetTruncated(i))
+        {
+            stats_.truncated++;
+        }
+    }
+    extractControls(n);
+
+    lastCount_ = n;
+    return n;
+}
+
+void UdpReceiver::extractControls(int count)
+{
+    // 取不到内核时间的数据报以本批返回时间代替，同时统计在套接字缓冲区中的等待时间
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    const uint64_t batchNs = static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+
+    for (int i = 0; i < count; ++i)
+    {
+        uint64_t rxNs = 0;
+        if (timestamps_ || dropCounter_)
+        {
+            struct msghdr &hdr = msgs_[i].msg_hdr;
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+            {
+                if (cmsg->cmsg_level != SOL_SOCKET)
+                {
+                    continue;
+                }
+                if (cmsg->cmsg_type == SCM_TIMESTAMPNS)
+                {
+                    struct timespec ts;
+                    memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                    rxNs = static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+                }
+                else if (cmsg->cmsg_type == SO_RXQ_OVFL)
+                {
+                    // 数据报入队时套接字的丢包累计数，只在发生过丢包后出现
+                    uint32_t drops = 0;
+                    memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                    if (drops > stats_.kernelDrops)
+                    {
+                        stats_.kernelDrops = drops;
+                    }
+                }
+            }
+        }
+
+        if (rxNs == 0)
+        {
+            rxNs = batchNs;
+            stats_.softwareTimestamps++;
+        }
+        else if (batchNs > rxNs)
+        {
+            Metrics::socketWait.observe(batchNs - rxNs);
+        }
+        rxTimes_[i] = rxNs;
+    }
+}
+
+std::string UdpReceiver::statsString() const
+{
+    std::ostringstream ss;
+    ss << "批大小=" << batchSize_
+       << ", 系统调用=" << stats_.syscalls
+       << ", 有效批次=" << stats_.batches
+       << ", 数据报=" << stats_.packets
+       << ", 平均每批=" << std::fixed << std::setprecision(2) << stats_.averageFill()
+       << ", 满批次=" << stats_.fullBatches
+       << ", 最大填充=" << stats_.maxFill
+       << ", 截断=" << stats_.truncated
+       << ", 池耗尽=" << stats_.poolExhausted
+       << ", 软件时间戳=" << stats_.softwareTimestamps
+       << ", 内核丢包=" << stats_.kernelDrops;
+
+    // 只输出出现过的填充数，便于调节批大小
+    ss << ", 填充分布={";
+    bool first = true;
+    for (size_t i = 1; i < stats_.fillHistogram.size(); ++i)
+    {
+        if (stats_.fillHistogram[i] == 0)
+        {
+            continue;
+        }
+        ss << (first ? "" : ", ") << i << ":" << stats_.fillHistogram[i];
+        first = false;
+    }
+    ss << "}";
+    return ss.str();
+}